@@ -0,0 +1,78 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__ATTRIBUTE_INDEX_H
+#define TEMOTO_CONTEXT_MANAGER__ATTRIBUTE_INDEX_H
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace emr
+{
+
+/**
+ * @brief Inverted index from (key, value) attributes to the names of the items that have them
+ *
+ * An item may have several values for the same key, e.g., one per detection method. Query
+ * results are returned in the lexicographical order of the names, which makes it possible to
+ * page through them with the last returned name as a cursor.
+ */
+class AttributeIndex
+{
+public:
+  typedef std::pair<std::string, std::string> Attribute;
+  typedef std::vector<Attribute> Attributes;
+  typedef std::function<bool(const std::string&)> Filter;
+
+  /**
+   * @brief Set the attributes of an item, replacing its previous attributes
+   *
+   * @param name
+   * @param attributes
+   */
+  void update(const std::string& name, Attributes attributes);
+
+  void remove(const std::string& name);
+
+  size_t size() const {return item_attributes_.size();}
+
+  /**
+   * @brief Get the names of the items that have all the given attributes
+   *
+   * @param constraints attributes the items must have, all items match if empty
+   * @param after only the names that are lexicographically greater than this are returned
+   * @param limit maximum number of returned names
+   * @param filter optional additional predicate the names must satisfy
+   * @return std::vector<std::string> sorted names
+   */
+  std::vector<std::string> query(const Attributes& constraints,
+                                 const std::string& after,
+                                 size_t limit,
+                                 const Filter& filter = Filter()) const;
+
+private:
+  /// Sorted and deduplicated attributes of every item
+  std::map<std::string, Attributes> item_attributes_;
+  std::map<Attribute, std::set<std::string>> postings_;
+};
+
+} // namespace emr
+
+#endif
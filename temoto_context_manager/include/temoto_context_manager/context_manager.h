@@ -31,18 +31,101 @@
 #include "temoto_context_manager/env_model_interface.h"
 #include "temoto_context_manager/emr_ros_interface.h"
 #include "temoto_context_manager/emr_item_to_component_link.h"
+#include "temoto_context_manager/emr_snapshot.h"
+#include "temoto_context_manager/emr_watch_manager.h"
+#include "temoto_context_manager/emr_shared_memory.h"
+#include "temoto_context_manager/tracked_object_demux.h"
 
 #include "temoto_action_engine/action_engine.h"
 #include "temoto_component_manager/component_manager_services.h"
 
+#include <ros/callback_queue.h>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
 namespace temoto_context_manager
 {
 
+/**
+ * @brief Defines which EMR items a manager advertises to other managers
+ * 
+ * FULL - every known item is advertised, including the ones learned from other managers
+ * OWNER_PARTITIONED - only the items maintained by this manager are advertised. Items of other
+ * maintainers are relayed only when their maintainer has not been heard from for a while
+ */
+enum class EmrSyncMode
+{
+  FULL,
+  OWNER_PARTITIONED
+};
+
+/**
+ * @brief A pipe that provides the raw data for tracking items
+ */
+struct TrackingPipe
+{
+  std::string pipe_category;
+  temoto_component_manager::LoadPipe load_pipe_msg;
+};
+
+/**
+ * @brief Tracker of an object, shared by all requests for tracking it
+ */
+struct SharedTracker
+{
+  /// Empty if the object is routed by the demultiplexer of its pipe
+  std::string umrf_graph_name;
+  std::string object_topic;
+
+  /// Key of the pipe that feeds the tracker, see ContextManager::acquireTrackingPipe()
+  std::string pipe_key;
+  std::string pipe_category;
+  int pipe_resource_id = 0;
+
+  /// Number of requests that hold the tracker
+  unsigned int holders = 0;
+
+  /// Distinguishes the tracker from the earlier trackers of the same object
+  uint64_t id = 0;
+
+  /// The tracker is being started by another request
+  bool starting = false;
+};
+
+/**
+ * @brief A tracking request's hold on a SharedTracker
+ */
+struct TrackerHold
+{
+  std::string object_name;
+  uint64_t tracker_id;
+};
+
+/**
+ * @brief Tracker that is shared by all objects of a pipe, and routes the detections to them
+ */
+struct TrackingDemux
+{
+  std::string umrf_graph_name;
+  std::shared_ptr<TrackedObjectDemux> demux;
+
+  /// The shared tracker is being started by another request
+  bool starting = false;
+};
+
 class ContextManager : public temoto_core::BaseSubsystem
 {
 public:
   ContextManager();
 
+  ~ContextManager();
+
   const std::string& getName() const
   {
     return subsystem_name_;
@@ -54,12 +137,180 @@ private:
 
   void unloadTrackObjectCb(TrackObject::Request& req, TrackObject::Response& res);
 
+  /**
+   * @brief Track a group of objects, loading each required pipe only once
+   * 
+   * Objects whose pipes are requested with the same parameters share a single pipe, which feeds
+   * the trackers of all of them.
+   */
+  void loadTrackObjectsCb(TrackObjects::Request& req, TrackObjects::Response& res);
+
+  void unloadTrackObjectsCb(TrackObjects::Request& req, TrackObjects::Response& res);
+
+  /**
+   * @brief Attach to the tracker of an object, starting it if the object is not tracked yet
+   * 
+   * The tracker is started without holding shared_trackers_mutex_. Meanwhile the requests for the
+   * same object wait for it to start.
+   * 
+   * @param object_name 
+   * @param use_only_local_resources only used when the tracker is started
+   * @return SharedTracker 
+   */
+  SharedTracker acquireTracker(const std::string& object_name, bool use_only_local_resources);
+
+  /**
+   * @brief Detach from the tracker of an object, which is stopped when its last holder leaves
+   * 
+   * @param object_name 
+   * @param tracker_id the hold is ignored if the tracker has been retired since, see statusCb2()
+   */
+  void releaseTracker(const std::string& object_name, uint64_t tracker_id);
+
+  /**
+   * @brief Stop a tracker that has been removed from shared_trackers_
+   */
+  void stopTracker(const std::string& object_name, const SharedTracker& tracker);
+
+  /**
+   * @brief Detach from a tracking pipe, which is unloaded when it does not feed any trackers
+   * 
+   * @param pipe_key 
+   */
+  void releaseTrackingPipe(const std::string& pipe_key);
+
+  /**
+   * @brief Start a TaTrackCmObject action
+   * 
+   * @param object_name the tracked object, empty makes the tracker publish all of its detections
+   * @param pipe that feeds the tracker
+   * @param output_topic 
+   * @param umrf_graph_name 
+   */
+  void startTrackerAction(const std::string& object_name
+                         , const TrackingPipe& pipe
+                         , const std::string& output_topic
+                         , const std::string& umrf_graph_name);
+
+  /**
+   * @brief Route the detections of the shared tracker of a pipe to an object
+   * 
+   * The shared tracker is started for the first object of the pipe
+   * 
+   * @param object_name 
+   * @param pipe_key 
+   * @param object_topic where the object is published
+   */
+  void attachToDemux(const std::string& object_name, const std::string& pipe_key, std::string& object_topic);
+
+  /**
+   * @brief Stop routing the detections to an object, the shared tracker is stopped after its last object
+   */
+  void detachFromDemux(const std::string& object_name, const std::string& pipe_key);
+
+  /**
+   * @brief Attach to a pipe that provides the raw data for tracking an item
+   * 
+   * The detection methods of the item are tried in their order of preference until a pipe is
+   * loaded. A loaded pipe that is requested with the same parameters is shared instead of
+   * loading it again. The pipes are loaded without holding shared_trackers_mutex_.
+   * 
+   * @param object_name 
+   * @param use_only_local_resources 
+   * @param pipe receives the attached pipe
+   * @return std::string key of the pipe in tracking_pipes_
+   */
+  std::string acquireTrackingPipe(const std::string& object_name
+                                 , bool use_only_local_resources
+                                 , TrackingPipe& pipe);
+
+  /**
+   * @brief Resolve the parameters of the segments of a pipe
+   * 
+   * @param pipe_info_msg 
+   * @param pipe_category 
+   * @param object_name 
+   * @param use_only_local_resources 
+   * @param pipe 
+   * @param pipe_key the serialized LoadPipe request
+   * @return true if the pipe can be loaded
+   * @return false if its parameters could not be specified
+   */
+  bool prepareTrackingPipe(const temoto_component_manager::Pipe& pipe_info_msg
+                          , const std::string& pipe_category
+                          , const std::string& object_name
+                          , bool use_only_local_resources
+                          , TrackingPipe& pipe
+                          , std::string& pipe_key);
+
+  /**
+   * @brief Load the first one of the pipes that succeeds
+   * 
+   * A single pipe is loaded on the calling thread. Several pipes are loaded concurrently and the
+   * ones that are loaded after the first are unloaded in the background, hence the call takes as
+   * long as the fastest successful load, or the slowest failed one.
+   * 
+   * @param pipes the loaded pipe receives the response of its LoadPipe call
+   * @return size_t index of the loaded pipe
+   */
+  size_t loadFirstPipe(std::vector<TrackingPipe>& pipes);
+
+  /**
+   * @brief Load a pipe and record its success and latency for ranking the pipes
+   */
+  void loadPipe(TrackingPipe& pipe);
+
+  void recordPipeLoad(const TrackingPipe& pipe, bool success, double latency);
+
+  /**
+   * @brief Start the tracker action of an item
+   * 
+   * @param object_name 
+   * @param pipe that feeds the tracker
+   * @param tracker_id see SharedTracker::id
+   * @param object_topic where the tracker publishes the item
+   * @return std::string name of the UMRF graph of the tracker
+   */
+  std::string startObjectTracker(const std::string& object_name
+                                , const TrackingPipe& pipe
+                                , uint64_t tracker_id
+                                , std::string& object_topic);
+
   void emrSyncCb(const temoto_core::ConfigSync& msg, const Items& payload);
   
   bool updateEmrCb(UpdateEmr::Request& req, UpdateEmr::Response& res);
 
   bool getEmrItemCb(GetEMRItem::Request& req, GetEMRItem::Response& res);
 
+  bool getEmrItemsCb(GetEMRItems::Request& req, GetEMRItems::Response& res);
+
+  bool getEmrItemsInRegionCb(GetEMRItemsInRegion::Request& req, GetEMRItemsInRegion::Response& res);
+
+  bool getEmrWorldPosesCb(GetEMRWorldPoses::Request& req, GetEMRWorldPoses::Response& res);
+
+  bool queryEmrCb(QueryEMR::Request& req, QueryEMR::Response& res);
+
+  bool watchEmrCb(WatchEmr::Request& req, WatchEmr::Response& res);
+
+  bool unwatchEmrCb(UnwatchEmr::Request& req, UnwatchEmr::Response& res);
+
+  /**
+   * @brief Forward an EMR modification to the watches and the client caches
+   * 
+   * Called by the EMR while it is locked.
+   */
+  void emrChangeCb(uint8_t action, const emr::Item& item, uint64_t version);
+
+  bool getEmrObjectsByTagCb(GetEMRObjectsByTag::Request& req, GetEMRObjectsByTag::Response& res);
+
+  bool getEmrPosesAtCb(GetEMRPosesAt::Request& req, GetEMRPosesAt::Response& res);
+
+  bool getEmrAtCb(GetEMRAt::Request& req, GetEMRAt::Response& res);
+
+  bool pinEmrVersionCb(PinEMRVersion::Request& req, PinEMRVersion::Response& res);
+
+  bool pingCb(PingContextManager::Request& req, PingContextManager::Response& res);
+
   bool getEmrVectorCb(GetEMRVector::Request& req, GetEMRVector::Response& res);
 
   void trackedObjectsSyncCb(const temoto_core::ConfigSync& msg, const std::string& payload);
@@ -99,10 +350,25 @@ private:
    */
   void advertiseEmr();
 
+  /**
+   * @brief Check if a remote manager has advertised its EMR recently
+   * 
+   * NB! emr_peers_mutex_ has to be locked by the caller
+   * 
+   * @param temoto_namespace 
+   * @return true if the manager has advertised within the peer timeout
+   * @return false otherwise
+   */
+  bool isEmrPeerReachable(const std::string& temoto_namespace) const;
+
   ObjectPtr findObject(std::string object_name);
 
   void statusCb1(temoto_core::ResourceStatus& srv);
 
+  /**
+   * @brief Receives the status of the pipes. A failed pipe retires the trackers it feeds and the
+   * failure is forwarded to every request that holds them
+   */
   void statusCb2(temoto_core::ResourceStatus& srv);
 
   void addDetectionMethod(std::string detection_method);
@@ -139,6 +405,48 @@ private:
 
   void timerCallback(const ros::TimerEvent&);
 
+  /**
+   * @brief Indexes the actions, starts the action engine and the component-to-EMR linker
+   * 
+   * Runs in the background after the EMR services have been advertised.
+   */
+  void startActionEngine();
+
+  /**
+   * @brief Block until the action engine has been started
+   * 
+   * Throws the startup error if the action engine failed to start, so that the requests that
+   * need it are rejected.
+   */
+  void waitForActionEngine();
+
+  /**
+   * @brief Restore the EMR from the last snapshot and the write-ahead log
+   * 
+   * The snapshot is loaded first and the write-ahead log records that are not included in the
+   * snapshot are replayed on top of it. Afterwards all EMR modifications are logged.
+   */
+  void restoreEmr();
+
+  /**
+   * @brief Write the current state of the EMR into the snapshot file
+   */
+  void saveEmrSnapshot();
+
+  void emrSnapshotTimerCallback(const ros::TimerEvent&);
+
+  void pipeStatisticsTimerCallback(const ros::TimerEvent&);
+
+  /**
+   * @brief Save the pipe statistics, if they have changed since they were last saved
+   */
+  void savePipeStatistics();
+
+  /**
+   * @brief Export the EMR to the shared memory if it has changed since the last export
+   */
+  void emrShmTimerCallback(const ros::TimerEvent&);
+
   // Resource manager for handling servers and clients
   temoto_core::trr::ResourceRegistrar<ContextManager> resource_registrar_1_;
 
@@ -149,17 +457,97 @@ private:
    */
   temoto_core::trr::ResourceRegistrar<ContextManager> resource_registrar_2_;
 
+  /*
+   * Separate callback queues for read-only queries, EMR modifications and synchronization, so
+   * that a slow request of one kind does not hold back the others. Object tracking requests
+   * are served by the resource registrar on the default queue.
+   */
+  ros::CallbackQueue query_cb_queue_;
+
+  ros::CallbackQueue mutation_cb_queue_;
+
+  ros::CallbackQueue sync_cb_queue_;
+
   ros::NodeHandle nh_;
 
+  ros::NodeHandle nh_query_;
+
+  ros::NodeHandle nh_mutation_;
+
+  ros::NodeHandle nh_sync_;
+
   ros::ServiceServer update_emr_server_;
 
   ros::ServiceServer get_emr_item_server_;
 
+  ros::ServiceServer get_emr_items_server_;
+
+  ros::ServiceServer get_emr_items_in_region_server_;
+
+  ros::ServiceServer get_emr_world_poses_server_;
+
+  ros::ServiceServer query_emr_server_;
+
+  ros::ServiceServer watch_emr_server_;
+
+  ros::ServiceServer unwatch_emr_server_;
+
+  ros::ServiceServer get_emr_objects_by_tag_server_;
+
+  ros::ServiceServer get_emr_poses_at_server_;
+
+  ros::ServiceServer get_emr_at_server_;
+
+  ros::ServiceServer pin_emr_version_server_;
+
+  ros::ServiceServer ping_server_;
+
   ros::ServiceServer get_emr_vector_server_;
 
+  std::unique_ptr<ros::AsyncSpinner> query_spinner_;
+
+  std::unique_ptr<ros::AsyncSpinner> mutation_spinner_;
+
+  std::unique_ptr<ros::AsyncSpinner> sync_spinner_;
+
   ObjectPtrs objects_;
 
-  std::map<int, std::string> m_tracked_objects_local_;
+  /// Protects the bookkeeping of locally tracked objects
+  std::mutex tracking_mutex_;
+
+  /// Tracked object per tracking request
+  std::map<int, TrackerHold> m_tracked_objects_local_;
+
+  /// Tracked objects per group tracking request
+  std::map<int, std::vector<TrackerHold>> m_tracked_object_groups_local_;
+
+  /**
+   * Trackers by the snake case object name and the pipes that feed them by their key. The pipes are loaded
+   * through resource_registrar_2_, so that they are not bound to the request that started them
+   * and can outlive it when other requests share the tracker
+   */
+  std::map<std::string, SharedTracker> shared_trackers_;
+
+  std::map<std::string, TrackingPipe> tracking_pipes_;
+
+  std::map<std::string, unsigned int> tracking_pipe_holders_;
+
+  /// Shared trackers by the key of their pipe
+  std::map<std::string, TrackingDemux> tracking_demuxes_;
+
+  /// Detection methods whose objects are tracked through a TrackingDemux, see the ~demux_detection_methods parameter
+  std::vector<std::string> demux_detection_methods_;
+
+  /// Keys of the pipes that are being loaded
+  std::set<std::string> starting_pipes_;
+
+  uint64_t next_tracker_id_ = 1;
+
+  /// Protects the bookkeeping of the trackers and their pipes
+  std::mutex shared_trackers_mutex_;
+
+  /// Notified when a tracker, a shared tracker or a pipe has finished starting
+  std::condition_variable shared_trackers_cv_;
 
   std::map<std::string, std::string> m_tracked_objects_remote_;
 
@@ -167,8 +555,32 @@ private:
 
   std::shared_ptr<EnvModelInterface> emr_interface; 
 
+  std::shared_ptr<emr_ros_interface::EmrRosInterface> emr_ros_interface_;
+
+  std::unique_ptr<EmrWatchManager> emr_watch_manager_;
+
+  ros::Publisher emr_invalidation_pub_;
+
   ros::Timer emr_sync_timer;
 
+  std::string emr_snapshot_path_;
+
+  ros::Timer emr_snapshot_timer_;
+
+  std::unique_ptr<EmrSharedMemoryWriter> emr_shm_writer_;
+
+  ros::Timer emr_shm_timer_;
+
+  /// Version of the latest EMR modification, see ItemContainer.version
+  std::atomic<uint64_t> emr_version_{0};
+
+  /// The EMR has changed since the last shared memory export. Set initially to export the restored EMR
+  std::atomic<bool> emr_shm_dirty_{true};
+
+  std::string emr_wal_directory_;
+
+  std::shared_ptr<EmrWriteAheadLog> emr_wal_;
+
 
   // Configuration syncer that manages external resource descriptions and synchronizes them
   // between all other (context) managers
@@ -176,12 +588,43 @@ private:
 
   temoto_core::trr::ConfigSynchronizer<ContextManager, std::string> tracked_objects_syncer_;
 
+  EmrSyncMode emr_sync_mode_;
+
+  ros::Duration emr_peer_timeout_;
+
+  /// Last time each remote manager advertised its EMR
+  std::map<std::string, ros::Time> emr_peers_last_seen_;
+
+  mutable std::mutex emr_peers_mutex_;
+
   ActionEngine action_engine_;
 
+  std::promise<void> action_engine_ready_promise_;
+
+  /// Becomes ready once the action engine has been started, holds the error if it failed to start
+  std::shared_future<void> action_engine_ready_;
+
+  std::thread action_engine_thread_;
+
   ComponentToEmrRegistry component_to_emr_registry_;
 
   std::map<std::string, temoto_core::Reliability> detection_method_history_;
 
+  std::string pipe_statistics_path_;
+
+  ros::Timer pipe_statistics_timer_;
+
+  /// A pipe load has been recorded since the statistics were last saved
+  std::atomic<bool> pipe_statistics_dirty_{false};
+
+  /// Number of pipes that are loaded concurrently when an object is tracked
+  int speculative_pipe_loads_;
+
+  /// Concurrent pipe loads, which may still be unloading their pipes
+  std::list<std::future<void>> pipe_loads_;
+
+  std::mutex pipe_loads_mutex_;
+
   std::pair<int, std::string> active_detection_method_;
 
   std::map<std::string, std::string> parameter_map_ =
@@ -36,6 +36,16 @@ namespace emr_ros_interface
     const std::string ROBOT = "ROBOT";
     const std::string COMPONENT = "COMPONENT";
   } // emr_containers namespace
+
+  /// Keys of the attributes that EMR items can be queried by
+  namespace emr_attributes
+  {
+    const std::string TYPE = "type";
+    const std::string MAINTAINER = "maintainer";
+    const std::string DETECTION_METHOD = "detection_method";
+    const std::string ODOM_FRAME_ID = "odom_frame_id";
+    const std::string BASE_FRAME_ID = "base_frame_id";
+  } // emr_attributes namespace
 } // emr_ros_interface namespace
 
 // TODO: this namespace should be renamed to "emr_ros_interface"
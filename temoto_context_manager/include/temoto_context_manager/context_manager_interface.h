@@ -25,12 +25,21 @@
 #include "temoto_core/common/console_colors.h"
 #include "temoto_core/common/topic_container.h"
 #include "temoto_core/common/ros_serialization.h"
+#include "temoto_core/common/tools.h"
 #include "temoto_context_manager/context_manager_services.h"
 #include "temoto_context_manager/context_manager_containers.h"
+#include "temoto_context_manager/worker_pool.h"
+#include "temoto_context_manager/persistent_service_client.h"
 
 #include "std_msgs/Float32.h"
 #include "std_msgs/String.h"
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace temoto_context_manager
@@ -69,9 +78,24 @@ public:
     resource_registrar_->registerStatusCb(&ContextManagerInterface::statusInfoCb);
 
     // Add EMR service client
-    update_EMR_client_ = nh_.serviceClient<UpdateEmr>(srv_name::SERVER_UPDATE_EMR);
-    get_emr_item_client_ = nh_.serviceClient<GetEMRItem>(srv_name::SERVER_GET_EMR_ITEM);
-    get_emr_vector_client_ = nh_.serviceClient<GetEMRVector>(srv_name::SERVER_GET_EMR_VECTOR);
+    // The calls that modify the manager are not retried, since the lost call may have been executed
+    update_EMR_client_ = PersistentServiceClient(nh_, srv_name::SERVER_UPDATE_EMR, false);
+    get_emr_item_client_ = PersistentServiceClient(nh_, srv_name::SERVER_GET_EMR_ITEM);
+    get_emr_items_client_ = PersistentServiceClient(nh_, srv_name::SERVER_GET_EMR_ITEMS);
+    get_emr_world_poses_client_ = PersistentServiceClient(nh_, srv_name::SERVER_GET_EMR_WORLD_POSES);
+    query_emr_client_ = PersistentServiceClient(nh_, srv_name::SERVER_QUERY_EMR);
+    watch_emr_client_ = PersistentServiceClient(nh_, srv_name::SERVER_WATCH_EMR, false);
+    unwatch_emr_client_ = PersistentServiceClient(nh_, srv_name::SERVER_UNWATCH_EMR);
+    get_emr_objects_by_tag_client_ = PersistentServiceClient(nh_, srv_name::SERVER_GET_EMR_OBJECTS_BY_TAG);
+    get_emr_poses_at_client_ = PersistentServiceClient(nh_, srv_name::SERVER_GET_EMR_POSES_AT);
+    get_emr_at_client_ = PersistentServiceClient(nh_, srv_name::SERVER_GET_EMR_AT);
+    pin_emr_version_client_ = PersistentServiceClient(nh_, srv_name::SERVER_PIN_EMR_VERSION, false);
+    get_emr_vector_client_ = PersistentServiceClient(nh_, srv_name::SERVER_GET_EMR_VECTOR);
+    ping_client_ = PersistentServiceClient(nh_, srv_name::SERVER_PING);
+
+    // Check the connection to the context manager periodically, so that dropped connections are
+    // noticed between the calls
+    health_check_timer_ = nh_.createWallTimer(ros::WallDuration(5.0), &ContextManagerInterface::healthCheckCb, this);
   }
 
   std::vector<ItemContainer> getEmrVector()
@@ -83,6 +107,29 @@ public:
     }
     return srv_msg.response.items;
   }
+
+  /**
+   * @brief Get one page of a subtree of the EMR
+   * 
+   * Pass the returned next_cursor back in request.cursor to get the next page.
+   * 
+   * @param request root, depth, type and page filters, see GetEMRVector.srv
+   * @return GetEMRVector::Response 
+   */
+  GetEMRVector::Response getEmrVector(const GetEMRVector::Request& request)
+  {
+    GetEMRVector srv_msg;
+    srv_msg.request = request;
+    if (!get_emr_vector_client_.call<GetEMRVector>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+    if (!srv_msg.response.success)
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Unknown EMR root item or cursor");
+    }
+    return srv_msg.response;
+  }
   /**
    * @brief Get a container from the EMR
    * 
@@ -110,6 +157,14 @@ public:
       {
         srv_msg.request.type = "MAP";
       }
+
+      const std::string cache_key = temoto_core::common::toSnakeCase(name);
+      ItemContainer cached_item;
+      if (getCachedEMRItem(cache_key, srv_msg.request.type, cached_item))
+      {
+        return temoto_core::deserializeROSmsg<Container>(cached_item.serialized_container);
+      }
+
       if (!get_emr_item_client_.call<GetEMRItem>(srv_msg)) 
       {
         throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
@@ -119,6 +174,7 @@ public:
       {
         container = temoto_core::deserializeROSmsg<Container>(
                                   srv_msg.response.item.serialized_container);
+        cacheEMRItem(cache_key, srv_msg.response.item);
         TEMOTO_INFO("Got a response! ");
       }
       else
@@ -130,6 +186,276 @@ public:
     
   }
 
+  struct EMRCacheStats
+  {
+    uint64_t hits;
+    uint64_t misses;
+    size_t size;
+
+    double hitRate() const
+    {
+      return hits + misses == 0 ? 0.0 : double(hits) / double(hits + misses);
+    }
+  };
+
+  /**
+   * @brief Serve getEMRContainer() from a local cache
+   * 
+   * The cache is kept coherent by the invalidations that the context manager publishes on every
+   * EMR change. Items are cached only while the invalidations are being received.
+   * 
+   * @param enable false drops the cache
+   */
+  void enableEMRCache(bool enable = true)
+  {
+    {
+      std::lock_guard<std::mutex> lock(emr_cache_mutex_);
+      emr_cache_enabled_ = enable;
+      emr_cache_.clear();
+      emr_cache_latest_versions_.clear();
+      emr_cache_hits_ = 0;
+      emr_cache_misses_ = 0;
+    }
+    if (enable)
+    {
+      emr_invalidation_subscriber_ = nh_.subscribe(srv_name::EMR_INVALIDATION_TOPIC
+                                                  , 1000
+                                                  , &ContextManagerInterface::emrInvalidationCb
+                                                  , this);
+    }
+    else
+    {
+      emr_invalidation_subscriber_.shutdown();
+    }
+  }
+
+  EMRCacheStats getEMRCacheStats()
+  {
+    std::lock_guard<std::mutex> lock(emr_cache_mutex_);
+    return EMRCacheStats{emr_cache_hits_, emr_cache_misses_, emr_cache_.size()};
+  }
+
+  /**
+   * @brief Get several containers of the same type from the EMR in a single request
+   * 
+   * The containers that do not exist in the EMR are left default-constructed.
+   * 
+   * @tparam Container 
+   * @param names 
+   * @return std::vector<Container> in the order of names
+   */
+  template<class Container>
+  std::vector<Container> getEMRContainers(const std::vector<std::string>& names)
+  {
+    GetEMRItems srv_msg;
+    srv_msg.request.names = names;
+    srv_msg.request.types.assign(names.size(), getContainerType<Container>());
+
+    if (!get_emr_items_client_.call<GetEMRItems>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+
+    std::vector<Container> containers(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      if (srv_msg.response.found[i])
+      {
+        containers[i] = temoto_core::deserializeROSmsg<Container>(
+                                   srv_msg.response.items[i].serialized_container);
+      }
+      else
+      {
+        TEMOTO_ERROR_STREAM("EMR has no item '" << names[i] << "' of type " << getContainerType<Container>());
+      }
+    }
+    return containers;
+  }
+
+  /**
+   * @brief Get the pose of an EMR item in the frame of its root item
+   * 
+   * @param name 
+   * @return geometry_msgs::PoseStamped, header.frame_id is the name of the root item
+   */
+  geometry_msgs::PoseStamped getWorldPose(const std::string& name)
+  {
+    std::vector<geometry_msgs::PoseStamped> poses = getWorldPoses(std::vector<std::string>{name});
+    return poses.front();
+  }
+
+  /**
+   * @brief Get the poses of several EMR items in the frames of their root items in a single request
+   * 
+   * @param names 
+   * @return std::vector<geometry_msgs::PoseStamped> in the order of names
+   */
+  std::vector<geometry_msgs::PoseStamped> getWorldPoses(const std::vector<std::string>& names)
+  {
+    GetEMRWorldPoses srv_msg;
+    srv_msg.request.names = names;
+    if (!get_emr_world_poses_client_.call<GetEMRWorldPoses>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      if (!srv_msg.response.found[i])
+      {
+        throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "EMR has no item '" + names[i] + "'");
+      }
+    }
+    return srv_msg.response.poses;
+  }
+
+  /**
+   * @brief Get one page of the EMR items that match the query
+   * 
+   * Pass the returned next_cursor back in query.cursor to get the next page.
+   * 
+   * @param query 
+   * @return QueryEMR::Response 
+   */
+  QueryEMR::Response queryEmr(const QueryEMR::Request& query)
+  {
+    QueryEMR srv_msg;
+    srv_msg.request = query;
+    if (!query_emr_client_.call<QueryEMR>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+    return srv_msg.response;
+  }
+
+  /**
+   * @brief Get notified about the modifications of the EMR items that match the filter
+   * 
+   * @param filter 
+   * @param callback invoked with the coalesced events
+   * @return uint32_t id of the watch
+   */
+  uint32_t watchEmr(const WatchEmr::Request& filter,
+                    const boost::function<void(const EmrEvents::ConstPtr&)>& callback)
+  {
+    WatchEmr srv_msg;
+    srv_msg.request = filter;
+    if (!watch_emr_client_.call<WatchEmr>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+    emr_watch_subscribers_[srv_msg.response.watch_id] = nh_.subscribe<EmrEvents>(srv_msg.response.topic, 100, callback);
+    return srv_msg.response.watch_id;
+  }
+
+  /**
+   * @brief Stop watching the EMR
+   * 
+   * @param watch_id 
+   */
+  void unwatchEmr(uint32_t watch_id)
+  {
+    emr_watch_subscribers_.erase(watch_id);
+    UnwatchEmr srv_msg;
+    srv_msg.request.watch_id = watch_id;
+    if (!unwatch_emr_client_.call<UnwatchEmr>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+  }
+
+  /**
+   * @brief Find the EMR objects that carry the detected AR tags in a single request
+   * 
+   * @param tag_ids 
+   * @return GetEMRObjectsByTag::Response with the names and poses in the order of tag_ids
+   */
+  GetEMRObjectsByTag::Response getEMRObjectsByTag(const std::vector<int16_t>& tag_ids)
+  {
+    GetEMRObjectsByTag srv_msg;
+    srv_msg.request.tag_ids = tag_ids;
+    if (!get_emr_objects_by_tag_client_.call<GetEMRObjectsByTag>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+    return srv_msg.response;
+  }
+
+  /**
+   * @brief Get the poses of EMR items at past times, interpolated from their pose histories
+   * 
+   * @param names 
+   * @param stamps one time per name, or a single time for all names
+   * @param found per-item status
+   * @return std::vector<geometry_msgs::PoseStamped> in the order of names
+   */
+  std::vector<geometry_msgs::PoseStamped> getEMRPosesAt(const std::vector<std::string>& names,
+                                                        const std::vector<ros::Time>& stamps,
+                                                        std::vector<bool>& found)
+  {
+    GetEMRPosesAt srv_msg;
+    srv_msg.request.names = names;
+    srv_msg.request.stamps = stamps;
+    if (!get_emr_poses_at_client_.call<GetEMRPosesAt>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+    found.assign(srv_msg.response.found.begin(), srv_msg.response.found.end());
+    return srv_msg.response.poses;
+  }
+
+  /**
+   * @brief Get the EMR, a subtree or an item as it was at a given version or time
+   * 
+   * @param request see GetEMRAt.srv
+   * @return GetEMRAt::Response 
+   */
+  GetEMRAt::Response getEMRAt(const GetEMRAt::Request& request)
+  {
+    GetEMRAt srv_msg;
+    srv_msg.request = request;
+    if (!get_emr_at_client_.call<GetEMRAt>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+    if (!srv_msg.response.success)
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "The requested EMR version is not available");
+    }
+    return srv_msg.response;
+  }
+
+  /**
+   * @brief Keep an EMR version available until it is unpinned, so that it can be read
+   * consistently by several requests
+   * 
+   * @param version 0 pins the latest version
+   * @return uint64_t number of the pinned version
+   */
+  uint64_t pinEMRVersion(uint64_t version = 0)
+  {
+    PinEMRVersion srv_msg;
+    srv_msg.request.version = version;
+    srv_msg.request.pin = true;
+    if (!pin_emr_version_client_.call<PinEMRVersion>(srv_msg) || !srv_msg.response.success) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to pin the EMR version");
+    }
+    return srv_msg.response.version;
+  }
+
+  bool unpinEMRVersion(uint64_t version)
+  {
+    PinEMRVersion srv_msg;
+    srv_msg.request.version = version;
+    srv_msg.request.pin = false;
+    if (!pin_emr_version_client_.call<PinEMRVersion>(srv_msg)) 
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+    }
+    return srv_msg.response.success;
+  }
+
   std::string trackObject(std::string object_name, bool use_only_local_resources = false)
   {
     // Validate the interface
@@ -153,6 +479,7 @@ public:
                                                               srv_name::TRACK_OBJECT_SERVER,
                                                               track_object_msg);
 
+      std::lock_guard<std::mutex> lock(allocated_track_objects_mutex_);
       allocated_track_objects_.push_back(track_object_msg);
       return track_object_msg.response.object_topic;
     }
@@ -161,6 +488,216 @@ public:
       throw FORWARD_ERROR(error_stack);
     }
   }
+  /**
+   * @brief Track a group of objects
+   * 
+   * Unlike calling trackObject() for each object, the pipes are loaded only once for all the
+   * objects that are detected with the same pipe.
+   * 
+   * @param object_names 
+   * @param use_only_local_resources 
+   * @return std::vector<std::string> topics of the objects, in the order of object_names
+   */
+  std::vector<std::string> trackObjects(const std::vector<std::string>& object_names, bool use_only_local_resources = false)
+  {
+    // Validate the interface
+    try
+    {
+      validateInterface();
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      throw FORWARD_ERROR(error_stack);
+    }
+
+    TrackObjects track_objects_msg;
+    track_objects_msg.request.object_names = object_names;
+    track_objects_msg.request.use_only_local_resources = use_only_local_resources;
+
+    try
+    {
+      resource_registrar_->template call<TrackObjects>(srv_name::MANAGER,
+                                                       srv_name::TRACK_OBJECTS_SERVER,
+                                                       track_objects_msg);
+
+      std::lock_guard<std::mutex> lock(allocated_track_objects_mutex_);
+      allocated_track_object_groups_.push_back(track_objects_msg);
+      return track_objects_msg.response.object_topics;
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      throw FORWARD_ERROR(error_stack);
+    }
+  }
+
+  /**
+   * @brief Whether the context manager answered the latest health check
+   */
+  bool isContextManagerReachable() const
+  {
+    return context_manager_reachable_;
+  }
+
+  /*
+   * Asynchronous variants of the blocking calls. They run on a pool of worker threads inside the
+   * interface, so that many requests can be outstanding at once. The returned futures rethrow the
+   * errors of the calls.
+   */
+
+  /**
+   * @brief Set the number of worker threads of the asynchronous calls
+   * 
+   * Takes effect if called before the first asynchronous call.
+   * 
+   * @param thread_count 
+   */
+  void setAsyncThreadCount(size_t thread_count)
+  {
+    std::lock_guard<std::mutex> lock(async_workers_mutex_);
+    if (!async_workers_)
+    {
+      async_thread_count_ = thread_count;
+    }
+  }
+
+  std::future<std::vector<ItemContainer>> getEmrVectorAsync()
+  {
+    return asyncWorkers().submit([this]{return getEmrVector();});
+  }
+
+  std::future<GetEMRVector::Response> getEmrVectorAsync(const GetEMRVector::Request& request)
+  {
+    return asyncWorkers().submit([this, request]{return getEmrVector(request);});
+  }
+
+  template <class Container>
+  std::future<Container> getEMRContainerAsync(const std::string& name)
+  {
+    return asyncWorkers().submit([this, name]{return getEMRContainer<Container>(name);});
+  }
+
+  template <class Container>
+  std::future<void> addToEmrAsync(const std::vector<Container>& containers)
+  {
+    return asyncWorkers().submit([this, containers]() mutable {addToEmr(containers);});
+  }
+
+  template <class Container>
+  std::future<void> addToEmrAsync(const Container& container)
+  {
+    return addToEmrAsync(std::vector<Container>{container});
+  }
+
+  std::future<std::string> trackObjectAsync(const std::string& object_name, bool use_only_local_resources = false)
+  {
+    return asyncWorkers().submit([this, object_name, use_only_local_resources]
+    {
+      return trackObject(object_name, use_only_local_resources);
+    });
+  }
+
+  /**
+   * @brief Set when the batched writes of addToEmrBatched() are sent
+   * 
+   * @param max_items a batch is sent as soon as it holds this many containers
+   * @param max_delay seconds, a batch is sent at the latest this long after its first container
+   */
+  void setEmrBatching(size_t max_items, double max_delay)
+  {
+    std::lock_guard<std::mutex> lock(emr_batch_mutex_);
+    emr_batch_max_items_ = std::max<size_t>(max_items, 1);
+    emr_batch_max_delay_ = ros::WallDuration(max_delay);
+  }
+
+  /**
+   * @brief Queue a container of any type to be added to the EMR in a batch
+   * 
+   * The queued containers are sent in a single UpdateEmr request when the batch is full, when
+   * its deadline passes or when flushEmrBatch() is called. See setEmrBatching().
+   * 
+   * @tparam Container 
+   * @param container 
+   * @return std::future<bool> false if the EMR rejected the container, throws if the request failed
+   */
+  template <class Container>
+  std::future<bool> addToEmrBatched(Container container)
+  {
+    EmrBatchEntry entry;
+    entry.item = toItemContainer(container);
+    std::future<bool> added = entry.added.get_future();
+
+    bool flush_now = false;
+    {
+      std::lock_guard<std::mutex> lock(emr_batch_mutex_);
+      emr_batch_.push_back(std::move(entry));
+      if (emr_batch_.size() >= emr_batch_max_items_)
+      {
+        flush_now = true;
+      }
+      else if (emr_batch_.size() == 1)
+      {
+        emr_batch_timer_ = nh_.createWallTimer(emr_batch_max_delay_, &ContextManagerInterface::emrBatchTimerCb, this, true);
+      }
+    }
+    if (flush_now)
+    {
+      asyncWorkers().submit([this]{flushEmrBatch();});
+    }
+    return added;
+  }
+
+  /**
+   * @brief Send the queued containers now and wait for the result
+   * 
+   * Flushes are sent in the order the containers were queued.
+   */
+  void flushEmrBatch()
+  {
+    std::lock_guard<std::mutex> flush_lock(emr_batch_flush_mutex_);
+    std::vector<EmrBatchEntry> batch;
+    {
+      std::lock_guard<std::mutex> lock(emr_batch_mutex_);
+      batch.swap(emr_batch_);
+      emr_batch_timer_.stop();
+    }
+    if (batch.empty())
+    {
+      return;
+    }
+
+    UpdateEmr update_EMR_srvmsg;
+    update_EMR_srvmsg.request.items.reserve(batch.size());
+    for (const EmrBatchEntry& entry : batch)
+    {
+      update_EMR_srvmsg.request.items.push_back(entry.item);
+    }
+
+    if (!update_EMR_client_.call<UpdateEmr>(update_EMR_srvmsg)) 
+    {
+      auto error = CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL, "Failed to call the server");
+      for (EmrBatchEntry& entry : batch)
+      {
+        entry.added.set_exception(std::make_exception_ptr(error));
+      }
+      throw error;
+    }
+
+    // The failed items are copies of the requested ones, in the same order
+    const std::vector<ItemContainer>& failed_items = update_EMR_srvmsg.response.failed_items;
+    size_t failed_index = 0;
+    for (EmrBatchEntry& entry : batch)
+    {
+      const bool failed = failed_index < failed_items.size() &&
+                          failed_items[failed_index].type == entry.item.type &&
+                          failed_items[failed_index].serialized_container == entry.item.serialized_container;
+      if (failed)
+      {
+        failed_index++;
+      }
+      entry.added.set_value(!failed);
+    }
+  }
+
   /**
    * @brief Add single container to EMR
    * 
@@ -189,36 +726,7 @@ public:
     std::vector<temoto_context_manager::ItemContainer> item_containers;
     for (auto& container : containers)
     {
-      if (container.name == "")
-      {
-        throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL , "The container is missing a name");
-      }
-      else
-      {
-        container.pose.header.stamp = ros::Time::now(); 
-        temoto_context_manager::ItemContainer nc;
-        // nc.last_modified = ros::Time::now();
-        nc.maintainer = temoto_core::common::getTemotoNamespace();
-        // Check the type of the container
-        if (std::is_same<Container, ObjectContainer>::value) 
-        {
-          nc.type = emr_ros_interface::emr_containers::OBJECT;
-        }
-        else if (std::is_same<Container, MapContainer>::value) 
-        {
-          nc.type = emr_ros_interface::emr_containers::MAP;
-        }
-        else if (std::is_same<Container, ComponentContainer>::value) 
-        {
-          nc.type = emr_ros_interface::emr_containers::COMPONENT;
-        }
-        else if (std::is_same<Container, RobotContainer>::value) 
-        {
-          nc.type = emr_ros_interface::emr_containers::ROBOT;
-        }
-        nc.serialized_container = temoto_core::serializeROSmsg(container);
-        item_containers.push_back(nc);
-      }
+      item_containers.push_back(toItemContainer(container));
     }
     UpdateEmr update_EMR_srvmsg;
     update_EMR_srvmsg.request.items = item_containers;
@@ -304,6 +812,29 @@ public:
     if (srv.request.status_code == temoto_core::trr::status_codes::FAILED)
     {
       TEMOTO_WARN("Received a notification about a resource failure. Unloading and trying again");
+      std::lock_guard<std::mutex> lock(allocated_track_objects_mutex_);
+
+      auto track_objects_it = std::find_if(allocated_track_object_groups_.begin(), allocated_track_object_groups_.end(),
+                                  [&](const TrackObjects& group) -> bool {
+                                    return group.response.trr.resource_id == srv.request.resource_id;
+                                  });
+
+      // The whole group is tracked again, since its objects may share the failed pipe
+      if (track_objects_it != allocated_track_object_groups_.end())
+      {
+        try
+        {
+          resource_registrar_->unloadClientResource(track_objects_it->response.trr.resource_id);
+          resource_registrar_->template call<TrackObjects>(srv_name::MANAGER,
+                                                           srv_name::TRACK_OBJECTS_SERVER,
+                                                           *track_objects_it);
+        }
+        catch(temoto_core::error::ErrorStack& error_stack)
+        {
+          throw FORWARD_ERROR(error_stack);
+        }
+        return;
+      }
 
       auto track_object_it = std::find_if(allocated_track_objects_.begin(), allocated_track_objects_.end(),
                                   [&](const TrackObject& sens) -> bool {
@@ -339,7 +870,18 @@ public:
   }
 
 
-  ~ContextManagerInterface(){}
+  ~ContextManagerInterface()
+  {
+    // Do not lose the containers that are still waiting in a batch
+    try
+    {
+      flushEmrBatch();
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      TEMOTO_ERROR_STREAM("Failed to add the batched containers to the EMR");
+    }
+  }
 
   const std::string& getName() const
   {
@@ -352,11 +894,216 @@ private:
 
   std::string name_; 
   ros::NodeHandle nh_;
-  ros::ServiceClient update_EMR_client_;
-  ros::ServiceClient get_emr_item_client_;
-  ros::ServiceClient get_emr_vector_client_;
+  PersistentServiceClient update_EMR_client_;
+  PersistentServiceClient get_emr_item_client_;
+  PersistentServiceClient get_emr_items_client_;
+  PersistentServiceClient get_emr_world_poses_client_;
+  PersistentServiceClient query_emr_client_;
+  PersistentServiceClient watch_emr_client_;
+  PersistentServiceClient unwatch_emr_client_;
+  PersistentServiceClient get_emr_objects_by_tag_client_;
+  PersistentServiceClient get_emr_poses_at_client_;
+  PersistentServiceClient get_emr_at_client_;
+  PersistentServiceClient pin_emr_version_client_;
+  PersistentServiceClient get_emr_vector_client_;
+  PersistentServiceClient ping_client_;
+
+  ros::WallTimer health_check_timer_;
+  std::atomic<bool> context_manager_reachable_{true};
+
+  /**
+   * @brief Ping the context manager and drop all connections if it does not answer, so that
+   * the next calls reconnect
+   */
+  void healthCheckCb(const ros::WallTimerEvent&)
+  {
+    PingContextManager srv_msg;
+    const bool reachable = ping_client_.call<PingContextManager>(srv_msg);
+    if (reachable == context_manager_reachable_)
+    {
+      return;
+    }
+    context_manager_reachable_ = reachable;
+    if (reachable)
+    {
+      TEMOTO_INFO_STREAM("The context manager is reachable again");
+      return;
+    }
+
+    TEMOTO_WARN_STREAM("The context manager does not answer, dropping the connections to it");
+    {
+      // The invalidations are not received either
+      std::lock_guard<std::mutex> lock(emr_cache_mutex_);
+      emr_cache_.clear();
+      emr_cache_latest_versions_.clear();
+    }
+    for (PersistentServiceClient* client : {&update_EMR_client_, &get_emr_item_client_, &get_emr_items_client_,
+                                            &get_emr_world_poses_client_, &query_emr_client_, &watch_emr_client_,
+                                            &unwatch_emr_client_, &get_emr_objects_by_tag_client_,
+                                            &get_emr_poses_at_client_, &get_emr_at_client_,
+                                            &pin_emr_version_client_, &get_emr_vector_client_})
+    {
+      client->reset();
+    }
+  }
 
   std::vector<TrackObject> allocated_track_objects_;
+  std::vector<TrackObjects> allocated_track_object_groups_;
+  std::mutex allocated_track_objects_mutex_;
+
+  std::map<uint32_t, ros::Subscriber> emr_watch_subscribers_;
+
+  /// EMR items by name, see enableEMRCache()
+  std::mutex emr_cache_mutex_;
+  bool emr_cache_enabled_ = false;
+  std::unordered_map<std::string, ItemContainer> emr_cache_;
+
+  /// Latest version announced by the invalidations, older responses are not cached
+  std::unordered_map<std::string, uint64_t> emr_cache_latest_versions_;
+  uint64_t emr_cache_hits_ = 0;
+  uint64_t emr_cache_misses_ = 0;
+  ros::Subscriber emr_invalidation_subscriber_;
+
+  bool getCachedEMRItem(const std::string& name, const std::string& type, ItemContainer& item)
+  {
+    std::lock_guard<std::mutex> lock(emr_cache_mutex_);
+    if (!emr_cache_enabled_)
+    {
+      return false;
+    }
+
+    // The invalidations of the cached items may have been missed while the manager was not
+    // connected, hence the cache is dropped
+    if (emr_invalidation_subscriber_.getNumPublishers() == 0 || !context_manager_reachable_)
+    {
+      emr_cache_.clear();
+      emr_cache_latest_versions_.clear();
+      emr_cache_misses_++;
+      return false;
+    }
+
+    const auto item_it = emr_cache_.find(name);
+    if (item_it == emr_cache_.end() || (!type.empty() && item_it->second.type != type))
+    {
+      emr_cache_misses_++;
+      return false;
+    }
+    emr_cache_hits_++;
+    item = item_it->second;
+    return true;
+  }
+
+  void cacheEMRItem(const std::string& name, const ItemContainer& item)
+  {
+    std::lock_guard<std::mutex> lock(emr_cache_mutex_);
+
+    // Without a connection to the manager the invalidations would be missed
+    if (!emr_cache_enabled_ || emr_invalidation_subscriber_.getNumPublishers() == 0)
+    {
+      return;
+    }
+
+    // A response that was overtaken by an invalidation is already outdated
+    const auto latest_it = emr_cache_latest_versions_.find(name);
+    if (latest_it != emr_cache_latest_versions_.end() && item.version < latest_it->second)
+    {
+      return;
+    }
+    emr_cache_[name] = item;
+  }
+
+  void emrInvalidationCb(const EmrInvalidation& msg)
+  {
+    std::lock_guard<std::mutex> lock(emr_cache_mutex_);
+    uint64_t& latest_version = emr_cache_latest_versions_[msg.name];
+    latest_version = std::max(latest_version, msg.version);
+
+    const auto item_it = emr_cache_.find(msg.name);
+    if (item_it != emr_cache_.end() && item_it->second.version < msg.version)
+    {
+      emr_cache_.erase(item_it);
+    }
+  }
+
+  WorkerPool& asyncWorkers()
+  {
+    std::lock_guard<std::mutex> lock(async_workers_mutex_);
+    if (!async_workers_)
+    {
+      async_workers_.reset(new WorkerPool(async_thread_count_));
+    }
+    return *async_workers_;
+  }
+
+  struct EmrBatchEntry
+  {
+    ItemContainer item;
+    std::promise<bool> added;
+  };
+
+  std::mutex emr_batch_mutex_;
+  std::vector<EmrBatchEntry> emr_batch_;
+  size_t emr_batch_max_items_ = 100;
+  ros::WallDuration emr_batch_max_delay_ = ros::WallDuration(0.05);
+  ros::WallTimer emr_batch_timer_;
+
+  /// Keeps the batches in order when several flushes overlap
+  std::mutex emr_batch_flush_mutex_;
+
+  void emrBatchTimerCb(const ros::WallTimerEvent&)
+  {
+    asyncWorkers().submit([this]{flushEmrBatch();});
+  }
+
+  /**
+   * @brief Stamp a container and wrap it into an ItemContainer
+   * 
+   * @tparam Container 
+   * @param container 
+   * @return ItemContainer 
+   */
+  template <class Container>
+  ItemContainer toItemContainer(Container& container)
+  {
+    if (container.name == "")
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::SERVICE_REQ_FAIL , "The container is missing a name");
+    }
+    container.pose.header.stamp = ros::Time::now(); 
+    temoto_context_manager::ItemContainer nc;
+    nc.maintainer = temoto_core::common::getTemotoNamespace();
+    nc.type = getContainerType<Container>();
+    nc.serialized_container = temoto_core::serializeROSmsg(container);
+    return nc;
+  }
+
+  /**
+   * @brief Get the EMR type name of a container
+   * 
+   * @tparam Container 
+   * @return std::string 
+   */
+  template <class Container>
+  std::string getContainerType() const
+  {
+    if (std::is_same<Container, ObjectContainer>::value) 
+    {
+      return emr_ros_interface::emr_containers::OBJECT;
+    }
+    else if (std::is_same<Container, MapContainer>::value) 
+    {
+      return emr_ros_interface::emr_containers::MAP;
+    }
+    else if (std::is_same<Container, ComponentContainer>::value) 
+    {
+      return emr_ros_interface::emr_containers::COMPONENT;
+    }
+    else if (std::is_same<Container, RobotContainer>::value) 
+    {
+      return emr_ros_interface::emr_containers::ROBOT;
+    }
+    return "";
+  }
 
   /**
    * @brief validateInterface()
@@ -369,6 +1116,11 @@ private:
       throw CREATE_ERROR(temoto_core::error::Code::UNINITIALIZED, "Interface is not initalized.");
     }
   }
+
+  /// Declared last, so that the pending asynchronous calls finish before the rest of the interface is destroyed
+  std::mutex async_workers_mutex_;
+  size_t async_thread_count_ = 4;
+  std::unique_ptr<WorkerPool> async_workers_;
 };
 
 } // namespace
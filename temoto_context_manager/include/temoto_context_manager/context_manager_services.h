@@ -22,9 +22,22 @@
 #include <string>
 #include "temoto_core/trr/resource_registrar_services.h"
 #include "temoto_context_manager/TrackObject.h"
+#include "temoto_context_manager/TrackObjects.h"
 #include "temoto_context_manager/UpdateEmr.h"
 #include "temoto_context_manager/GetEMRItem.h"
+#include "temoto_context_manager/GetEMRItems.h"
+#include "temoto_context_manager/GetEMRItemsInRegion.h"
+#include "temoto_context_manager/GetEMRWorldPoses.h"
+#include "temoto_context_manager/QueryEMR.h"
+#include "temoto_context_manager/WatchEmr.h"
+#include "temoto_context_manager/UnwatchEmr.h"
+#include "temoto_context_manager/GetEMRObjectsByTag.h"
+#include "temoto_context_manager/GetEMRPosesAt.h"
+#include "temoto_context_manager/GetEMRAt.h"
+#include "temoto_context_manager/PinEMRVersion.h"
 #include "temoto_context_manager/GetEMRVector.h"
+#include "temoto_context_manager/PingContextManager.h"
+#include "temoto_context_manager/EmrInvalidation.h"
 
 namespace temoto_context_manager
 {
@@ -33,14 +46,27 @@ namespace temoto_context_manager
     const std::string MANAGER = "temoto_context_manager";
     const std::string SYNC_OBJECTS_TOPIC = "/temoto_context_manager/"+MANAGER+"/sync_objects";
     const std::string SYNC_TRACKED_OBJECTS_TOPIC= "/temoto_context_manager/"+MANAGER+"/sync_tracked_objects";
+    const std::string EMR_INVALIDATION_TOPIC = "/temoto_context_manager/"+MANAGER+"/emr_invalidations";
     const std::string TRACK_OBJECT_SERVER = "track_objects";
+    const std::string TRACK_OBJECTS_SERVER = "track_object_group";
 
     const std::string MANAGER_2 = "temoto_context_manager_2";
     const std::string TRACKER_SERVER = "load_tracker";
 
     const std::string SERVER_UPDATE_EMR = MANAGER + "/update_emr";
     const std::string SERVER_GET_EMR_ITEM = "get_emr_item";
+    const std::string SERVER_GET_EMR_ITEMS = "get_emr_items";
+    const std::string SERVER_GET_EMR_ITEMS_IN_REGION = "get_emr_items_in_region";
+    const std::string SERVER_GET_EMR_WORLD_POSES = "get_emr_world_poses";
+    const std::string SERVER_QUERY_EMR = "query_emr";
+    const std::string SERVER_WATCH_EMR = "watch_emr";
+    const std::string SERVER_UNWATCH_EMR = "unwatch_emr";
+    const std::string SERVER_GET_EMR_OBJECTS_BY_TAG = "get_emr_objects_by_tag";
+    const std::string SERVER_GET_EMR_POSES_AT = "get_emr_poses_at";
+    const std::string SERVER_GET_EMR_AT = "get_emr_at";
+    const std::string SERVER_PIN_EMR_VERSION = "pin_emr_version";
     const std::string SERVER_GET_EMR_VECTOR = "get_emr_vector";
+    const std::string SERVER_PING = "ping_context_manager";
   }
 }
 
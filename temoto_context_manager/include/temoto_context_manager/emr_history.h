@@ -0,0 +1,155 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__EMR_HISTORY_H
+#define TEMOTO_CONTEXT_MANAGER__EMR_HISTORY_H
+
+#include "temoto_context_manager/context_manager_containers.h"
+#include "temoto_context_manager/persistent_hash_map.h"
+#include <ros/time.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Versioned history of the EMR
+ *
+ * Every modification of the EMR produces a new version, which is an immutable map of the items
+ * that shares everything but the modified path with the previous version. Versions older than
+ * the retention period, or beyond the maximum number of versions, are dropped unless they are
+ * pinned. Reading a version only copies its root under a short lock, so readers never wait for
+ * the EMR and never block its writers.
+ */
+class EmrHistory
+{
+public:
+  struct Entry
+  {
+    ItemContainer item;
+    std::string parent;
+  };
+
+  typedef emr::PersistentHashMap<Entry> State;
+
+  struct Version
+  {
+    uint64_t number;
+    ros::Time stamp;
+    State state;
+  };
+
+  /**
+   * @brief Construct a new EMR history
+   *
+   * @param retention versions that were replaced longer ago are dropped
+   * @param max_versions maximum number of unpinned versions kept
+   */
+  EmrHistory(const ros::Duration& retention, size_t max_versions);
+
+  /**
+   * @brief Record a new version where the item was added or updated
+   *
+   * @param name
+   * @param entry
+   * @param stamp time of the modification
+   * @return uint64_t number of the new version
+   */
+  uint64_t put(const std::string& name, const Entry& entry, const ros::Time& stamp);
+
+  /**
+   * @brief Record a new version where the item was removed
+   *
+   * @param name
+   * @param stamp time of the modification
+   * @return uint64_t number of the new version
+   */
+  uint64_t erase(const std::string& name, const ros::Time& stamp);
+
+  /**
+   * @brief Get a version by its number
+   *
+   * @param number 0 selects the latest version
+   * @param version
+   * @return true if the version is still kept
+   * @return false otherwise
+   */
+  bool getVersion(uint64_t number, Version& version) const;
+
+  /**
+   * @brief Get the version that was current at the given time
+   *
+   * @param stamp
+   * @param version
+   * @return true if the version is still kept
+   * @return false otherwise
+   */
+  bool getVersionAt(const ros::Time& stamp, Version& version) const;
+
+  /**
+   * @brief Keep a version regardless of the retention until it is unpinned
+   *
+   * A version can be pinned several times, it is released after the same number of unpins.
+   *
+   * @param number 0 selects the latest version
+   * @return uint64_t number of the pinned version, 0 if the version is not kept anymore
+   */
+  uint64_t pin(uint64_t number);
+
+  bool unpin(uint64_t number);
+
+private:
+  /**
+   * @brief Append a version and drop the versions that fell out of the retention
+   *
+   * The caller must hold mutex_.
+   */
+  uint64_t commit(State state, const ros::Time& stamp);
+
+  /**
+   * @brief Get a version by its number without locking mutex_
+   */
+  bool getVersionUnsafe(uint64_t number, Version& version) const;
+
+  struct Pin
+  {
+    Version version;
+    size_t count;
+
+    /// Time when the next version was made, zero while the version is still in versions_
+    ros::Time replaced;
+  };
+
+  ros::Duration retention_;
+  size_t max_versions_;
+
+  mutable std::mutex mutex_;
+  std::deque<Version> versions_;
+
+  /// Pinned versions with their pin counts, including the ones that were dropped from versions_
+  std::map<uint64_t, Pin> pinned_;
+  uint64_t next_number_;
+};
+
+} // temoto_context_manager namespace
+
+#endif
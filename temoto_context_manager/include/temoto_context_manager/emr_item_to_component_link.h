@@ -22,6 +22,7 @@
 #include "temoto_component_manager/Component.h"
 #include "temoto_component_manager/Pipe.h"
 #include "temoto_context_manager/env_model_repository.h"
+#include "temoto_context_manager/pipe_statistics.h"
 #include <mutex>
 #include <vector>
 #include <map>
@@ -97,8 +98,41 @@ public:
 
   bool hasPipe(std::string pipe_type) const;
 
+  /**
+   * @brief Get the pipe of a category that is expected to load the fastest
+   * 
+   * @param pipe_type 
+   * @param ret_pipe 
+   * @return true if the category has pipes
+   * @return false otherwise
+   */
   bool getPipeByType(std::string pipe_type, temoto_component_manager::Pipe& ret_pipe);
 
+  /**
+   * @brief Get the pipes of a category, ranked by their success rate and load latency
+   * 
+   * @param pipe_type 
+   * @return std::vector<temoto_component_manager::Pipe> the pipe that is expected to load the
+   * fastest first, empty if the category is unknown
+   */
+  std::vector<temoto_component_manager::Pipe> getPipesByType(std::string pipe_type) const;
+
+  /**
+   * @brief Record the outcome of a pipe load attempt, which is used for ranking the pipes
+   * 
+   * @param pipe_name 
+   * @param success 
+   * @param latency seconds it took to load the pipe or to fail
+   */
+  void recordPipeLoad(const std::string& pipe_name, bool success, double latency);
+
+  bool loadPipeStatistics(const std::string& path);
+
+  /**
+   * @brief Write a snapshot of the pipe statistics into a file, the registry is not locked during the write
+   */
+  bool savePipeStatistics(const std::string& path) const;
+
   bool addPipe(temoto_component_manager::Pipe pipe_info);
 
   bool setPipes(CategorizedPipes cat_pipes);
@@ -111,6 +145,7 @@ private:
   std::vector<ComponentToEmrLink> component_to_emr_links_;
   std::vector<ComponentToPipeLink> component_to_pipe_links_;
   CategorizedPipes categorized_pipe_infos_;
+  PipeStatistics pipe_statistics_;
 
 };
 } // temoto_context_manager namespace
@@ -20,15 +20,30 @@
 #define TEMOTO_CONTEXT_MANAGER__EMR_ROS_INTERFACE_H
 
 #include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <tf/transform_broadcaster.h>
+#include <tf/transform_datatypes.h>
 #include <ros/ros.h>
 #include "ros/package.h"
 
 #include "temoto_context_manager/context_manager_containers.h"
 #include "temoto_context_manager/env_model_repository.h"
 #include "temoto_context_manager/env_model_interface.h"
+#include "temoto_context_manager/emr_write_ahead_log.h"
+#include "temoto_context_manager/spatial_index.h"
+#include "temoto_context_manager/attribute_index.h"
+#include "temoto_context_manager/pose_history.h"
+#include "temoto_context_manager/timer_wheel.h"
+#include "temoto_context_manager/emr_history.h"
+#include "temoto_context_manager/EmrEvent.h"
 #include "temoto_core/common/ros_serialization.h"
 #include "temoto_core/common/tools.h"
+#include "geometry_msgs/Point.h"
 #include "geometry_msgs/PoseStamped.h"
 
 namespace emr_ros_interface
@@ -102,6 +117,12 @@ public:
    * @return RosMsg 
    */
   RosMsg getPayload() const {return payload_;};
+  /**
+   * @brief Get the payload without copying it
+   * 
+   * @return const RosMsg& 
+   */
+  const RosMsg& getPayloadRef() const {return payload_;};
   /**
    * @brief Set the payload 
    * 
@@ -119,6 +140,22 @@ public:
 
 };
 
+/**
+ * @brief Result of a spatial query
+ * 
+ */
+struct SpatialMatch
+{
+  std::string name;
+
+  /// Name of the root item, in whose frame the position is expressed
+  std::string frame_id;
+  geometry_msgs::Point position;
+
+  /// Distance from the query center (radius and nearest queries) or box center (box queries)
+  double distance;
+};
+
 class EmrRosInterface : public temoto_context_manager::EnvModelInterface
 {
 public:
@@ -143,12 +180,188 @@ public:
   std::vector<ItemContainer> updateEmr(const ItemContainer & item_to_add, bool update_time=false);
   std::vector<ItemContainer> EmrToVector();
 
-  EmrRosInterface(emr::EnvironmentModelRepository& emr, std::string identifier) : env_model_repository_(emr), identifier_(identifier) 
+  /**
+   * @brief Get one page of a subtree of the EMR
+   * 
+   * The items are returned in depth-first order, parents before their children, so every page can
+   * be fed to updateEmr() as it is.
+   * 
+   * @param root the subtree root, all root items if empty
+   * @param max_depth number of levels returned, starting from the root, 0 returns all levels
+   * @param type only the items of this type are returned, if not empty
+   * @param cursor the page starts after the item with this name, from the beginning if empty
+   * @param page_size maximum number of returned items, 0 returns all of them
+   * @param next_cursor cursor of the next page, empty if this was the last page
+   * @param success false if the root or the cursor item does not exist
+   * @return std::vector<ItemContainer> 
+   */
+  std::vector<ItemContainer> EmrToVector(const std::string& root,
+                                         uint32_t max_depth,
+                                         const std::string& type,
+                                         const std::string& cursor,
+                                         size_t page_size,
+                                         std::string& next_cursor,
+                                         bool& success);
+  std::vector<ItemContainer> getItems(const std::vector<std::string>& names, std::vector<bool>& found);
+  std::vector<TaggedObject> getObjectsByTagIds(const std::vector<int16_t>& tag_ids, std::vector<bool>& found);
+  bool getPoseAt(const std::string& name, const ros::Time& stamp, geometry_msgs::PoseStamped& pose);
+  std::vector<geometry_msgs::PoseStamped> getPosesAt(const std::vector<std::string>& names,
+                                                     const std::vector<ros::Time>& stamps,
+                                                     std::vector<bool>& found);
+
+  /**
+   * @brief Keep a history of the poses of every item
+   * 
+   * Only the poses that are set after this call are recorded.
+   * 
+   * @param length number of poses kept per item, 0 disables the history
+   * @param horizon seconds, poses older than this relative to the newest pose are not used
+   */
+  void configurePoseHistory(size_t length, double horizon);
+
+  /**
+   * @brief Track the age of the item poses and act on the items whose pose is older than its
+   * time-to-live
+   * 
+   * Stale items are not published to TF and are flagged in the returned ItemContainers, until
+   * their pose is updated again. Only the items that are modified after this call are tracked.
+   * 
+   * @param ttls time-to-live in seconds, by item name or by container type. Item names take
+   * precedence, items that match neither never go stale
+   * @param expire remove the stale items from the EMR instead of flagging them
+   * @param resolution seconds, granularity of the expiry checks
+   */
+  void configureTtl(const std::map<std::string, double>& ttls, bool expire, double resolution);
+  bool isStale(const std::string& name);
+
+  /**
+   * @brief Keep a versioned history of the EMR
+   * 
+   * The items that are already in the EMR become the first versions of the history.
+   * 
+   * @param retention seconds, a version is dropped once it has been replaced for longer than
+   * this, 0 disables the history
+   * @param max_versions maximum number of versions kept, not counting the pinned ones
+   */
+  void configureHistory(double retention, size_t max_versions);
+
+  /**
+   * @brief Get an EMR version, or a subtree of it
+   * 
+   * Reads the immutable version without locking the EMR. The items are returned in depth-first
+   * order, parents before their children.
+   * 
+   * @param version number of the version, 0 selects it by stamp
+   * @param stamp the version that was current at this time is returned, the latest version if zero
+   * @param root the subtree root, all root items if empty
+   * @param max_depth number of levels returned, starting from the root, 0 returns all levels
+   * @param found_version the returned version
+   * @param success false if the history is disabled, the version is not kept anymore or the root
+   * did not exist in it
+   * @return std::vector<ItemContainer> 
+   */
+  std::vector<ItemContainer> getEmrAt(uint64_t version,
+                                      const ros::Time& stamp,
+                                      const std::string& root,
+                                      uint32_t max_depth,
+                                      EmrHistory::Version& found_version,
+                                      bool& success);
+
+  /**
+   * @brief Keep an EMR version available until it is unpinned, see EmrHistory::pin()
+   * 
+   * @param version 0 pins the latest version
+   * @return uint64_t number of the pinned version, 0 on failure
+   */
+  uint64_t pinVersion(uint64_t version);
+  bool unpinVersion(uint64_t version);
+  bool getWorldPose(const std::string& name, geometry_msgs::PoseStamped& pose);
+  std::vector<geometry_msgs::PoseStamped> getWorldPoses(const std::vector<std::string>& names, std::vector<bool>& found);
+
+  EmrRosInterface(emr::EnvironmentModelRepository& emr, std::string identifier, double spatial_cell_size = 1.0)
+  : env_model_repository_(emr), identifier_(identifier), spatial_cell_size_(spatial_cell_size)
 {
+  // Versions continue from the wall time, so they keep increasing after a restart
+  change_counter_ = ros::WallTime::now().toNSec();
+
   // TODO: Move this to context manager
   tf_timer_ = nh_.createTimer(ros::Duration(0.1), &EmrRosInterface::emrTfCallback, this);
 }
   void updatePose(const std::string& name, const geometry_msgs::PoseStamped& newPose);
+
+  /**
+   * @brief Get the items within a radius, sorted by distance
+   * 
+   * @param frame_id name of the root item the query is expressed in, all roots are searched if empty
+   * @param center 
+   * @param radius 
+   * @return std::vector<SpatialMatch> 
+   */
+  std::vector<SpatialMatch> radiusSearch(const std::string& frame_id, const geometry_msgs::Point& center, double radius);
+
+  /**
+   * @brief Get the items within an axis-aligned box
+   * 
+   * @param frame_id name of the root item the query is expressed in, all roots are searched if empty
+   * @param min_corner 
+   * @param max_corner 
+   * @return std::vector<SpatialMatch> 
+   */
+  std::vector<SpatialMatch> boxSearch(const std::string& frame_id,
+                                      const geometry_msgs::Point& min_corner,
+                                      const geometry_msgs::Point& max_corner);
+
+  /**
+   * @brief Get the k items nearest to the center, sorted by distance
+   * 
+   * @param frame_id name of the root item the query is expressed in, all roots are searched if empty
+   * @param center 
+   * @param k 
+   * @return std::vector<SpatialMatch> 
+   */
+  std::vector<SpatialMatch> nearestSearch(const std::string& frame_id, const geometry_msgs::Point& center, size_t k);
+
+  /**
+   * @brief Get one page of the items that have all the given attributes
+   * 
+   * The items are returned in the order of their names.
+   * 
+   * @param constraints (key, value) pairs, see emr_attributes for the keys
+   * @param subtree_root if not empty, only this item and its descendants are returned
+   * @param cursor only the items whose names follow the cursor are returned
+   * @param page_size maximum number of returned items
+   * @param next_cursor cursor of the next page, empty if this was the last page
+   * @param items if not null, filled with the matching items
+   * @return std::vector<std::string> names of the matching items
+   */
+  std::vector<std::string> queryItems(const emr::AttributeIndex::Attributes& constraints,
+                                      const std::string& subtree_root,
+                                      const std::string& cursor,
+                                      size_t page_size,
+                                      std::string& next_cursor,
+                                      std::vector<ItemContainer>* items = nullptr);
+
+  /**
+   * @brief Log all subsequent modifications of the EMR to a write-ahead log
+   * 
+   * @param wal 
+   */
+  void setWriteAheadLog(std::shared_ptr<temoto_context_manager::EmrWriteAheadLog> wal);
+
+  /**
+   * @brief Callback that is invoked on every modification, while the EMR is locked
+   * 
+   * The first argument is one of the EmrEvent actions. The item is passed before it is removed.
+   * The last argument is the version of the item after the change, see ItemContainer.version.
+   */
+  typedef std::function<void(uint8_t, const emr::Item&, uint64_t)> ChangeCallback;
+
+  /**
+   * @brief Report all subsequent modifications of the EMR to a callback
+   * 
+   * @param callback 
+   */
+  void setChangeCallback(ChangeCallback callback);
   /**
    * @brief Helper function to handle templates
    * 
@@ -160,10 +373,18 @@ public:
   void updatePoseHelper(const std::string& name, const geometry_msgs::PoseStamped& newPose)
   {
     std::shared_ptr<RosPayload<Container>> plptr = getRosPayloadPtr<Container>(name); 
-    std::lock_guard<std::mutex> lock(emr_iface_mutex);
+    std::lock_guard<std::shared_timed_mutex> lock(emr_iface_mutex);
     auto temp = plptr->getPayload();
     temp.pose = newPose;
     plptr->setPayload(temp);
+    updateWorldTransforms(temoto_core::common::toSnakeCase(name));
+    recordPose(temoto_core::common::toSnakeCase(name), newPose);
+    scheduleExpiry(temoto_core::common::toSnakeCase(name));
+    notifyChange(temoto_context_manager::EmrEvent::UPDATED, temoto_core::common::toSnakeCase(name));
+    if (wal_)
+    {
+      wal_->appendPoseUpdate(temoto_core::common::toSnakeCase(name), temoto_core::serializeROSmsg(newPose));
+    }
   }
   /**
    * @brief Get the Container by name
@@ -175,7 +396,7 @@ public:
   template<class Container>
   Container getContainer(const std::string& name)
   {
-    std::lock_guard<std::mutex> lock(emr_iface_mutex);
+    std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
     // TODO: What if a null pointer is returned?
     return getRosPayloadPtr<Container>(name)->getPayload();
   }
@@ -215,13 +436,17 @@ public:
    * @tparam Container 
    * @param container 
    * @param container_type 
+   * @param changed false if the item was left as it was, since the container is not newer than it
+   * @return false if the container could not be applied
    */
   template <class Container>
   bool addOrUpdateEmrItem(const Container & container, 
                           const std::string& container_type, 
                           const std::string& maintainer, 
-                          const bool update_time)
+                          const bool update_time,
+                          bool& changed)
   {
+  changed = false;
   RosPayload<Container> rospl = RosPayload<Container>(container);
   rospl.setType(container_type);
   std::string name = temoto_core::common::toSnakeCase(container.name);
@@ -249,16 +474,31 @@ public:
     rospl.setMaintainer(maintainer);
     std::shared_ptr<RosPayload<Container>> plptr = std::make_shared<RosPayload<Container>>(rospl);
     env_model_repository_.addItem(name, parent, plptr);
+    updateWorldTransforms(name);
+    updateAttributeIndex(name, container, container_type, maintainer);
+    updateTagIndex(name, container);
+    recordPose(name, plptr->getPayloadRef().pose);
+    scheduleExpiry(name);
+    notifyChange(temoto_context_manager::EmrEvent::ADDED, name);
+    changed = true;
   }
   else
   {
     if (rospl.getTime() > getRosPayloadPtr<Container>(name)->getTime()) 
     {
-      // Update the item information
+      // Update the item information. The item keeps its original maintainer
       if (update_time) rospl.updateTime();
+      rospl.setMaintainer(getRosPayloadPtr<Container>(name)->getMaintainer());
       std::shared_ptr<RosPayload<Container>> plptr = std::make_shared<RosPayload<Container>>(rospl);
       env_model_repository_.updateItem(name, plptr);
+      updateWorldTransforms(name);
+      updateAttributeIndex(name, container, container_type, plptr->getMaintainer());
+      updateTagIndex(name, container);
+      recordPose(name, plptr->getPayloadRef().pose);
+      scheduleExpiry(name);
+      notifyChange(temoto_context_manager::EmrEvent::UPDATED, name);
       ROS_INFO_STREAM("Updated item: " << name);
+      changed = true;
     }
   }
   return true;
@@ -272,6 +512,55 @@ public:
    */
   void EmrToVectorHelper(const emr::Item& currentItem, std::vector<temoto_context_manager::ItemContainer>& items);
 
+  /**
+   * @brief Serialize the payload of an item into an ItemContainer
+   * 
+   * @param item 
+   * @param container 
+   * @return true if the payload type was recognized
+   * @return false otherwise
+   */
+  bool itemToContainer(const emr::Item& item, temoto_context_manager::ItemContainer& container);
+
+  /**
+   * @brief Restore the state of the depth-first traversal of EmrToVector() right after an item
+   * 
+   * The state is rebuilt from the ancestors of the item, so a page costs the same regardless of
+   * how far into the EMR it starts.
+   * 
+   * @param start_items the items the traversal starts from
+   * @param subtree whether start_items holds a subtree root rather than all root items
+   * @param max_depth 
+   * @param cursor snake case name of the item
+   * @param stack receives the items to visit next, with their depths
+   * @return true on success
+   * @return false if the item does not exist or the traversal does not reach it
+   */
+  bool seekTraversal(const std::vector<std::shared_ptr<emr::Item>>& start_items,
+                     bool subtree,
+                     uint32_t max_depth,
+                     const std::string& cursor,
+                     std::vector<std::pair<std::shared_ptr<emr::Item>, uint32_t>>& stack);
+
+  /**
+   * @brief Serialize the Container payload of an item into an ItemContainer
+   * 
+   * The children of a removed item became root items, hence the parent of a root item is
+   * cleared, so that the container can be added back to the EMR.
+   */
+  template <class Container>
+  void serializePayload(const emr::Item& item, temoto_context_manager::ItemContainer& ic)
+  {
+    std::shared_ptr<RosPayload<Container>> rospl = std::dynamic_pointer_cast<RosPayload<Container>>(item.getPayload());
+    Container container = rospl->getPayload();
+    if (!item.getParent().lock())
+    {
+      container.parent.clear();
+    }
+    ic.serialized_container = temoto_core::serializeROSmsg(container);
+    ic.maintainer = rospl->getMaintainer();
+  }
+
   /**
    * @brief Update pose of EMR item
    * 
@@ -315,8 +604,203 @@ private:
   ros::NodeHandle nh_;
   ros::Timer tf_timer_;
   tf::TransformBroadcaster tf_broadcaster;
-  mutable std::mutex emr_iface_mutex;
-  
+  /// Queries take a shared lock and may run concurrently, modifications take an exclusive lock
+  mutable std::shared_timed_mutex emr_iface_mutex;
+  std::shared_ptr<temoto_context_manager::EmrWriteAheadLog> wal_;
+
+  struct WorldTransform
+  {
+    /// Name of the root item, i.e., the frame the transform is expressed in
+    std::string root;
+    tf::Transform transform;
+    ros::Time stamp;
+  };
+
+  /// Composed transforms from the root item to every non-root item
+  std::unordered_map<std::string, WorldTransform> world_transforms_;
+
+  /// Positions of the items in the frame of their root item, one index per root item
+  std::map<std::string, emr::SpatialIndex> spatial_indexes_;
+  double spatial_cell_size_;
+
+  ChangeCallback change_callback_;
+
+  /// Version of the latest modification, and of the latest modification of every item
+  uint64_t change_counter_;
+  std::unordered_map<std::string, uint64_t> item_versions_;
+
+  /**
+   * @brief Invoke the change callback, if there is one
+   * 
+   * The caller must hold an exclusive lock on emr_iface_mutex.
+   * 
+   * @param action 
+   * @param name 
+   */
+  void notifyChange(uint8_t action, const std::string& name);
+
+  /// Type, maintainer and container specific attributes of every item
+  emr::AttributeIndex attribute_index_;
+
+  /**
+   * @brief Index the queryable attributes of an item
+   * 
+   * The caller must hold an exclusive lock on emr_iface_mutex.
+   */
+  template <class Container>
+  void updateAttributeIndex(const std::string& name,
+                            const Container& container,
+                            const std::string& type,
+                            const std::string& maintainer)
+  {
+    emr::AttributeIndex::Attributes attributes {{emr_attributes::TYPE, type},
+                                                {emr_attributes::MAINTAINER, maintainer}};
+    addContainerAttributes(container, attributes);
+    attribute_index_.update(name, attributes);
+  }
+
+  void addContainerAttributes(const ObjectContainer& container, emr::AttributeIndex::Attributes& attributes);
+  void addContainerAttributes(const MapContainer& container, emr::AttributeIndex::Attributes& attributes);
+  void addContainerAttributes(const ComponentContainer& container, emr::AttributeIndex::Attributes& attributes);
+  void addContainerAttributes(const RobotContainer& container, emr::AttributeIndex::Attributes& attributes);
+
+  /// Recent poses of every item, relative to its parent
+  std::unordered_map<std::string, PoseHistory> pose_histories_;
+  size_t pose_history_length_ = 0;
+  ros::Duration pose_history_horizon_;
+
+  /**
+   * @brief Append a pose to the history of an item
+   * 
+   * The caller must hold an exclusive lock on emr_iface_mutex.
+   * 
+   * @param name 
+   * @param pose 
+   */
+  void recordPose(const std::string& name, const geometry_msgs::PoseStamped& pose);
+
+  /// Null if the history is disabled
+  std::unique_ptr<EmrHistory> history_;
+
+  /**
+   * @brief Record a modification of an item in the history
+   * 
+   * The caller must hold an exclusive lock on emr_iface_mutex.
+   * 
+   * @param action one of the EmrEvent actions
+   * @param item 
+   */
+  void recordHistory(uint8_t action, const emr::Item& item);
+
+  /// Time-to-live by item name or container type, empty if staleness is not tracked
+  std::unordered_map<std::string, double> ttls_;
+  bool expire_stale_items_ = false;
+  double expiry_resolution_ = 0.1;
+  emr::TimerWheel expiry_wheel_;
+  std::unordered_set<std::string> stale_items_;
+  ros::Timer expiry_timer_;
+
+  /**
+   * @brief Set the expiry deadline of an item from its current pose and clear its stale flag
+   * 
+   * The caller must hold an exclusive lock on emr_iface_mutex.
+   * 
+   * @param name 
+   */
+  void scheduleExpiry(const std::string& name);
+
+  /**
+   * @brief Mark or remove the items whose deadline has passed
+   */
+  void expiryTimerCallback(const ros::TimerEvent&);
+
+  /**
+   * @brief Remove an item without locking mutex
+   * 
+   * @param name 
+   */
+  void removeItemUnsafe(const std::string& name);
+
+  /// Names of the objects that can be detected by AR tags, by tag id
+  std::unordered_map<int16_t, std::string> tag_index_;
+  std::unordered_map<std::string, int16_t> item_tags_;
+
+  /**
+   * @brief Index the AR tag of an object
+   * 
+   * Only objects carry AR tags, an item that is replaced by another type of container is removed
+   * from the index. The caller must hold an exclusive lock on emr_iface_mutex.
+   */
+  template <class Container>
+  void updateTagIndex(const std::string& name, const Container& container)
+  {
+    (void)container;
+    removeFromTagIndex(name);
+  }
+  void updateTagIndex(const std::string& name, const ObjectContainer& container);
+  void removeFromTagIndex(const std::string& name);
+
+  /**
+   * @brief Get the pose of the item relative to its parent
+   * 
+   * @param item 
+   * @param pose 
+   * @return true if the payload type was recognized
+   * @return false otherwise
+   */
+  bool getItemPose(const emr::Item& item, geometry_msgs::PoseStamped& pose);
+
+  /**
+   * @brief Get the pose of the item relative to its parent
+   * 
+   * @param item 
+   * @param stamp timestamp of the pose
+   * @return tf::Transform 
+   */
+  tf::Transform getItemTransform(const emr::Item& item, ros::Time& stamp);
+
+  /**
+   * @brief Recompose the world transforms of the item and its descendants after the item was added
+   * or moved, and reindex their positions
+   * 
+   * The transforms of the other items stay cached. The caller must hold an exclusive lock on
+   * emr_iface_mutex.
+   * 
+   * @param name 
+   */
+  void updateWorldTransforms(const std::string& name);
+  void updateWorldTransformsHelper(const emr::Item& item,
+                                   const tf::Transform& parent_transform,
+                                   const std::string& root,
+                                   emr::SpatialIndex& index);
+
+  /**
+   * @brief Drop the world transforms and spatial index entries of the item and its descendants
+   * 
+   * The caller must hold an exclusive lock on emr_iface_mutex.
+   * 
+   * @param item 
+   */
+  void removeWorldTransforms(const std::shared_ptr<emr::Item>& item);
+
+  /**
+   * @brief Get the world pose without locking mutex
+   * 
+   * @param name 
+   * @param pose 
+   * @return true if the item exists
+   * @return false otherwise
+   */
+  bool getWorldPoseUnsafe(const std::string& name, geometry_msgs::PoseStamped& pose);
+
+  /**
+   * @brief Run a query on the spatial index of the given root item, or on all of them
+   * 
+   * @tparam Search callable that takes a spatial index and returns its matches
+   */
+  template <class Search>
+  std::vector<SpatialMatch> searchSpatialIndexes(const std::string& frame_id, Search search);
+
   void emrTfCallback(const ros::TimerEvent&);
   template <class Container>
   void publishContainerTf(const Container& container);
@@ -0,0 +1,166 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__EMR_SHARED_MEMORY_H
+#define TEMOTO_CONTEXT_MANAGER__EMR_SHARED_MEMORY_H
+
+#include "temoto_context_manager/context_manager_containers.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Layout of the shared memory segment that holds the latest EMR snapshot
+ *
+ * The segment consists of this header followed by a data region of "capacity" bytes, which
+ * holds an EmrSnapshot. The data region and "size" are protected by a seqlock: the writer makes
+ * "sequence" odd before it modifies them and even again afterwards, and a reader retries if the
+ * sequence was odd or changed while it was reading.
+ */
+struct EmrSharedMemoryHeader
+{
+  static constexpr uint32_t LAYOUT_VERSION = 1;
+
+  char magic[8];
+  uint32_t layout_version;
+  uint32_t reserved;
+  uint64_t capacity;
+  std::atomic<uint64_t> sequence;
+  uint64_t size;
+  uint64_t published_ns;
+};
+
+/**
+ * @brief Publishes EMR snapshots to a POSIX shared memory segment
+ *
+ * The segment is kept when the writer is destroyed, and a restarted writer continues in the
+ * same segment, so the readers do not have to reopen it. A writer with a different capacity
+ * reinitializes the segment, continuing its sequence, and never shrinks it.
+ */
+class EmrSharedMemoryWriter
+{
+public:
+  /**
+   * @brief Create or open the segment
+   *
+   * @param name name of the segment, e.g. "/temoto_emr"
+   * @param capacity maximum size of a snapshot in bytes. Only the pages that are written take
+   * up memory
+   */
+  EmrSharedMemoryWriter(const std::string& name, size_t capacity);
+
+  ~EmrSharedMemoryWriter();
+
+  EmrSharedMemoryWriter(const EmrSharedMemoryWriter&) = delete;
+  EmrSharedMemoryWriter& operator=(const EmrSharedMemoryWriter&) = delete;
+
+  bool isOpen() const {return header_ != nullptr;}
+
+  /**
+   * @brief Encode the items and publish them as the latest snapshot
+   *
+   * @param items
+   * @param version version of the EMR that the items represent
+   * @return true on success
+   * @return false if the segment is not open or the snapshot exceeds the capacity
+   */
+  bool write(const Items& items, uint64_t version);
+
+private:
+  std::string name_;
+  EmrSharedMemoryHeader* header_;
+  uint8_t* data_;
+  size_t mapped_size_;
+  std::vector<uint8_t> buffer_;
+};
+
+/**
+ * @brief Reads the EMR snapshots published by an EmrSharedMemoryWriter
+ *
+ * After the segment is mapped, reading involves no system calls.
+ */
+class EmrSharedMemoryReader
+{
+public:
+  /**
+   * @brief Consistent view of the snapshot bytes
+   *
+   * The callable receives a pointer into the shared memory and the size of the snapshot. The
+   * writer may modify the bytes while they are being read, in which case the read is retried,
+   * so the callable must tolerate inconsistent data and must not keep the pointer.
+   */
+  typedef std::function<void(const uint8_t*, size_t)> Visitor;
+
+  explicit EmrSharedMemoryReader(const std::string& name);
+
+  ~EmrSharedMemoryReader();
+
+  EmrSharedMemoryReader(const EmrSharedMemoryReader&) = delete;
+  EmrSharedMemoryReader& operator=(const EmrSharedMemoryReader&) = delete;
+
+  /**
+   * @brief Map the segment if it is not mapped yet
+   *
+   * @return true if the segment is mapped
+   * @return false if the segment does not exist (yet)
+   */
+  bool open();
+
+  /**
+   * @brief Sequence number of the latest snapshot, 0 if none has been published
+   *
+   * Cheap enough to poll, a snapshot has to be read again only when this changes.
+   */
+  uint64_t getSequence();
+
+  /**
+   * @brief Read the snapshot bytes in place
+   *
+   * Gives up if the writer does not finish its write within a short timeout.
+   *
+   * @param visitor
+   * @return uint64_t sequence number of the snapshot that was read, 0 if none was
+   */
+  uint64_t read(const Visitor& visitor);
+
+  /**
+   * @brief Copy out the latest snapshot and decode it
+   *
+   * @param items
+   * @param version version of the EMR that the items represent
+   * @return uint64_t sequence number of the snapshot that was read, 0 if none was
+   */
+  uint64_t readItems(Items& items, uint64_t& version);
+
+private:
+  void close();
+
+  std::string name_;
+  const EmrSharedMemoryHeader* header_;
+  const uint8_t* data_;
+  size_t mapped_size_;
+  std::vector<uint8_t> buffer_;
+};
+
+} // temoto_context_manager namespace
+
+#endif
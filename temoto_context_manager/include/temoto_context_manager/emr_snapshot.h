@@ -0,0 +1,117 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__EMR_SNAPSHOT_H
+#define TEMOTO_CONTEXT_MANAGER__EMR_SNAPSHOT_H
+
+#include "temoto_context_manager/context_manager_containers.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Binary snapshot of the EMR
+ *
+ * The snapshot consists of a fixed size header, a table of fixed size entries (one per item)
+ * and a data region that holds the strings and the serialized containers. All offsets in the
+ * entry table are relative to the beginning of the data region, hence the snapshot can be
+ * memory-mapped and decoded in place. The items are stored in the order returned by
+ * EmrToVector(), i.e., parents always precede their children.
+ */
+class EmrSnapshot
+{
+public:
+  static constexpr uint32_t FORMAT_VERSION = 2;
+
+  struct Header
+  {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t item_count;
+    uint64_t created_ns;
+
+    /// Sequence number of the last write-ahead log record included in the snapshot
+    uint64_t wal_sequence;
+    uint64_t data_size;
+  };
+
+  struct Entry
+  {
+    uint32_t type_offset;
+    uint32_t type_size;
+    uint32_t maintainer_offset;
+    uint32_t maintainer_size;
+    uint32_t container_offset;
+    uint32_t container_size;
+  };
+
+  /**
+   * @brief Encode the items into a snapshot buffer
+   *
+   * @param items
+   * @param wal_sequence
+   * @param buffer
+   * @return true on success
+   * @return false if the items do not fit into the 32-bit offsets of the format (4 GiB)
+   */
+  static bool encode(const Items& items, uint64_t wal_sequence, std::vector<uint8_t>& buffer);
+
+  /**
+   * @brief Decode the items from a snapshot buffer
+   *
+   * @param data
+   * @param size
+   * @param items
+   * @param wal_sequence
+   * @return true if the buffer contained a valid snapshot
+   * @return false otherwise
+   */
+  static bool decode(const uint8_t* data, size_t size, Items& items, uint64_t& wal_sequence);
+
+  /**
+   * @brief Write the snapshot to a file
+   *
+   * The snapshot is written to a temporary file first, which is then renamed over the
+   * destination, so a crash during writing never leaves a partially written snapshot behind.
+   * The file and its directory are flushed before returning, so the snapshot survives a power loss.
+   *
+   * @param path
+   * @param items
+   * @param wal_sequence
+   * @return true on success
+   * @return false on failure
+   */
+  static bool write(const std::string& path, const Items& items, uint64_t wal_sequence);
+
+  /**
+   * @brief Memory-map the snapshot file and decode the items
+   *
+   * @param path
+   * @param items
+   * @param wal_sequence
+   * @return true if the file existed and contained a valid snapshot
+   * @return false otherwise
+   */
+  static bool read(const std::string& path, Items& items, uint64_t& wal_sequence);
+};
+
+} // temoto_context_manager namespace
+
+#endif
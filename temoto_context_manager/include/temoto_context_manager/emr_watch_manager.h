@@ -0,0 +1,127 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__EMR_WATCH_MANAGER_H
+#define TEMOTO_CONTEXT_MANAGER__EMR_WATCH_MANAGER_H
+
+#include "temoto_context_manager/env_model_interface.h"
+#include "temoto_context_manager/env_model_repository.h"
+#include "temoto_context_manager/WatchEmr.h"
+#include "temoto_context_manager/EmrEvents.h"
+#include <ros/ros.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Publishes the EMR modifications that match the registered watches
+ *
+ * The EMR reports every modification through onChange(), which only records the name of the
+ * modified item in the matching watches. A background thread publishes the recorded events,
+ * reading the current state of the items from the EMR. Several modifications of an item that
+ * arrive before its watch is due are coalesced into a single event.
+ */
+class EmrWatchManager
+{
+public:
+  /**
+   * @param nh
+   * @param emr_interface
+   * @param subscribe_timeout a watch that nobody has subscribed to within this time is dropped
+   */
+  EmrWatchManager(const ros::NodeHandle& nh
+                 , std::shared_ptr<EnvModelInterface> emr_interface
+                 , const ros::WallDuration& subscribe_timeout = ros::WallDuration(30.0));
+
+  ~EmrWatchManager();
+
+  /**
+   * @brief Register a watch and advertise its topic
+   *
+   * @param filter
+   * @param topic where the events of the watch are published
+   * @return uint32_t id of the watch
+   */
+  uint32_t addWatch(const WatchEmr::Request& filter, std::string& topic);
+
+  /**
+   * @brief Unregister a watch
+   *
+   * @param watch_id
+   * @return true if the watch existed
+   * @return false otherwise
+   */
+  bool removeWatch(uint32_t watch_id);
+
+  /**
+   * @brief Record a modification of the EMR
+   *
+   * Called by the EMR while it is locked, hence it does not touch the EMR itself.
+   *
+   * @param action one of the EmrEvent actions
+   * @param item the modified item
+   */
+  void onChange(uint8_t action, const emr::Item& item);
+
+private:
+  struct Watch
+  {
+    std::string name;
+    std::string subtree_root;
+    std::string type;
+    ros::WallDuration min_period;
+    ros::WallTime last_publish;
+    ros::Publisher publisher;
+
+    /// Becomes true once a client has subscribed, the watch is dropped after it leaves
+    bool had_subscribers;
+
+    /// The watch is dropped if no client has subscribed within subscribe_timeout_ of this
+    ros::WallTime created;
+
+    /// Latest action per item since the last publish
+    std::map<std::string, uint8_t> pending;
+  };
+
+  void publishLoop();
+
+  ros::NodeHandle nh_;
+  std::shared_ptr<EnvModelInterface> emr_interface_;
+  ros::WallDuration subscribe_timeout_;
+
+  std::mutex watches_mutex_;
+  std::map<uint32_t, Watch> watches_;
+  uint32_t next_watch_id_;
+
+  /// Lets onChange() return without locking when nobody is watching
+  std::atomic<size_t> watch_count_;
+
+  std::atomic<bool> running_;
+  std::condition_variable publish_cv_;
+  std::thread publish_thread_;
+};
+
+} // temoto_context_manager namespace
+
+#endif
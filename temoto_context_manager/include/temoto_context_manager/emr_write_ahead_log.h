@@ -0,0 +1,159 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__EMR_WRITE_AHEAD_LOG_H
+#define TEMOTO_CONTEXT_MANAGER__EMR_WRITE_AHEAD_LOG_H
+
+#include "temoto_context_manager/context_manager_containers.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Segmented write-ahead log of EMR modifications
+ *
+ * Every modification is appended to the active segment as a checksummed record with a
+ * monotonically increasing sequence number. The records are written immediately, but the
+ * segment is fsync'ed in batches by a background thread, once per sync period. Segments are
+ * named after the sequence number of their first record.
+ *
+ * On startup the log is replayed on top of the last snapshot: only the records with a sequence
+ * number greater than the one stored in the snapshot are applied. Replay stops at the first
+ * torn or corrupted record, which gives a crash consistent prefix of the modifications.
+ */
+class EmrWriteAheadLog
+{
+public:
+  enum class Operation : uint8_t
+  {
+    UPDATE_ITEM = 1,
+    UPDATE_POSE = 2,
+    REMOVE_ITEM = 3
+  };
+
+  struct Record
+  {
+    uint64_t sequence;
+    Operation operation;
+
+    /// Item that was added or updated (UPDATE_ITEM)
+    ItemContainer item;
+
+    /// Name of the item (UPDATE_POSE, REMOVE_ITEM)
+    std::string name;
+
+    /// Serialized geometry_msgs::PoseStamped (UPDATE_POSE)
+    std::vector<uint8_t> serialized_pose;
+  };
+
+  /**
+   * @brief Construct a new write-ahead log
+   *
+   * @param directory where the segments are stored, created if it does not exist
+   * @param segment_size size in bytes after which a new segment is started
+   * @param sync_period seconds between the batched fsyncs
+   */
+  EmrWriteAheadLog(const std::string& directory, size_t segment_size, double sync_period);
+
+  ~EmrWriteAheadLog();
+
+  /**
+   * @brief Replay the records in sequence order
+   *
+   * Only a single record is kept in memory at a time.
+   *
+   * @param after_sequence records with a sequence number up to (and including) this are skipped
+   * @param callback invoked for every replayed record
+   * @return number of replayed records
+   */
+  size_t replay(uint64_t after_sequence, const std::function<void(const Record&)>& callback);
+
+  /**
+   * @brief Start a new segment and the background sync thread
+   *
+   * Must be called after replay() and before any records are appended.
+   *
+   * @return true on success
+   * @return false if the segment could not be created
+   */
+  bool start();
+
+  void appendItemUpdate(const ItemContainer& item);
+
+  void appendPoseUpdate(const std::string& name, const std::vector<uint8_t>& serialized_pose);
+
+  void appendItemRemoval(const std::string& name);
+
+  /**
+   * @brief Get the sequence number of the last appended record
+   *
+   * @return uint64_t
+   */
+  uint64_t getLastSequence() const;
+
+  /**
+   * @brief Remove the segments that are fully covered by a snapshot
+   *
+   * @param snapshot_sequence sequence number stored in the newer snapshot
+   */
+  void compact(uint64_t snapshot_sequence);
+
+private:
+  struct Segment
+  {
+    uint64_t first_sequence;
+    std::string path;
+  };
+
+  std::vector<Segment> listSegments() const;
+
+  bool openSegment(uint64_t first_sequence);
+
+  void writeRecord(Operation operation, const std::vector<uint8_t>& payload);
+
+  void syncLoop();
+
+  std::string directory_;
+  size_t segment_size_;
+  double sync_period_;
+
+  /// Protects the active segment and the sequence counter
+  mutable std::mutex log_mutex_;
+  int active_fd_;
+
+  /// Descriptors of replaced segments, fsync'ed and closed by the sync thread
+  std::vector<int> retired_fds_;
+  size_t active_size_;
+  uint64_t last_sequence_;
+  bool dirty_;
+
+  std::atomic<bool> running_;
+  std::condition_variable sync_cv_;
+  std::thread sync_thread_;
+};
+
+} // temoto_context_manager namespace
+
+#endif
@@ -25,6 +25,21 @@
 namespace temoto_context_manager
 {
 
+/**
+ * @brief Object that can be detected by an AR tag
+ * 
+ */
+struct TaggedObject
+{
+  std::string name;
+
+  /// Pose of the object relative to its parent
+  geometry_msgs::PoseStamped pose;
+
+  /// Pose of the object relative to the tag
+  geometry_msgs::Pose obj_relative_pose;
+};
+
 /**
  * @brief Abstract class to describe required functionalities of environment model 
  * 
@@ -129,6 +144,72 @@ public:
    */
   virtual std::vector<ItemContainer> EmrToVector() = 0;
 
+  /**
+   * @brief Get several items as temoto_context_manager::ItemContainer under a single lock
+   * 
+   * @param names 
+   * @param found per-item status, false if the item does not exist
+   * @return std::vector<ItemContainer> in the order of names
+   */
+  virtual std::vector<ItemContainer> getItems(const std::vector<std::string>& names, std::vector<bool>& found) = 0;
+
+  /**
+   * @brief Get the pose of an item in the frame of its root item
+   * 
+   * The poses are composed up the tree and cached, so repeated queries on a static
+   * environment do not recompose them.
+   * 
+   * @param name 
+   * @param pose header.frame_id is set to the name of the root item
+   * @return true if the item exists
+   * @return false otherwise
+   */
+  virtual bool getWorldPose(const std::string& name, geometry_msgs::PoseStamped& pose) = 0;
+
+  /**
+   * @brief Get the poses of several items in the frames of their root items under a single lock
+   * 
+   * @param names 
+   * @param found per-item status, false if the item does not exist
+   * @return std::vector<geometry_msgs::PoseStamped> in the order of names
+   */
+  virtual std::vector<geometry_msgs::PoseStamped> getWorldPoses(const std::vector<std::string>& names,
+                                                                std::vector<bool>& found) = 0;
+
+  /**
+   * @brief Get the pose of an item at a past time, interpolated from its pose history
+   * 
+   * @param name 
+   * @param stamp 
+   * @param pose relative to the parent of the item
+   * @return true on success
+   * @return false if the item has no history that covers the time
+   */
+  virtual bool getPoseAt(const std::string& name, const ros::Time& stamp, geometry_msgs::PoseStamped& pose) = 0;
+
+  /**
+   * @brief Get the poses of several items at past times under a single lock
+   * 
+   * @param names 
+   * @param stamps one time per name, or a single time for all names
+   * @param found per-item status
+   * @return std::vector<geometry_msgs::PoseStamped> in the order of names
+   */
+  virtual std::vector<geometry_msgs::PoseStamped> getPosesAt(const std::vector<std::string>& names,
+                                                             const std::vector<ros::Time>& stamps,
+                                                             std::vector<bool>& found) = 0;
+
+  /**
+   * @brief Find the objects that carry the given AR tags under a single lock
+   * 
+   * Only the objects that list ObjectContainer::ARTAG among their detection methods are considered.
+   * 
+   * @param tag_ids 
+   * @param found per-tag status, false if no object carries the tag
+   * @return std::vector<TaggedObject> in the order of tag_ids
+   */
+  virtual std::vector<TaggedObject> getObjectsByTagIds(const std::vector<int16_t>& tag_ids, std::vector<bool>& found) = 0;
+
   /**
    * @brief Update pose of EM item
    * 
@@ -19,7 +19,13 @@
 #ifndef TEMOTO_CONTEXT_MANAGER__ENV_MODEL_REPOSITORY_H
 #define TEMOTO_CONTEXT_MANAGER__ENV_MODEL_REPOSITORY_H
 
+#include <map>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
 namespace emr 
 {
 
@@ -66,6 +72,7 @@ private:
 public:
 
   void addChild(std::shared_ptr<Item> child);
+  void removeChild(const std::shared_ptr<Item>& child);
   /**
    * @brief Set the Parent pointer
    * 
@@ -126,17 +133,22 @@ class EnvironmentModelRepository
 {
 private:
   std::map<std::string, std::shared_ptr<Item>> items;
-  mutable std::mutex emr_mutex; 
+  /// Readers take a shared lock, so concurrent queries do not serialize on each other
+  mutable std::shared_timed_mutex emr_mutex; 
 public:
   const std::map<std::string, std::shared_ptr<Item>>& getItems() 
   {
-    std::lock_guard<std::mutex> lock(emr_mutex);
+    std::shared_lock<std::shared_timed_mutex> lock(emr_mutex);
     return items;
   }
-  void removeItem(const std::string name)
-  {
-    items.erase(name);
-  }
+  /**
+   * @brief Remove a item from the EMR
+   * 
+   * The item is detached from its parent. Its children become root items.
+   * 
+   * @param name 
+   */
+  void removeItem(const std::string name);
   /**
    * @brief Get the root items of the structure
    * 
@@ -172,12 +184,17 @@ public:
    * @brief Get shared_ptr to item by name
    * 
    * @param item_name 
-   * @return std::shared_ptr<Item> 
+   * @return std::shared_ptr<Item>, nullptr if the item does not exist
    */
-  const std::shared_ptr<Item> getItemByName(std::string item_name)
+  const std::shared_ptr<Item> getItemByName(std::string item_name) const
   {
-    std::lock_guard<std::mutex> lock(emr_mutex);
-    return items[item_name];
+    std::shared_lock<std::shared_timed_mutex> lock(emr_mutex);
+    const auto item_it = items.find(item_name);
+    if (item_it == items.end())
+    {
+      return nullptr;
+    }
+    return item_it->second;
   }
   /**
    * @brief Check if EMR contains a item with the given name
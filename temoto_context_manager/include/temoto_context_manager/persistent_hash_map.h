@@ -0,0 +1,328 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__PERSISTENT_HASH_MAP_H
+#define TEMOTO_CONTEXT_MANAGER__PERSISTENT_HASH_MAP_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace emr
+{
+
+/**
+ * @brief Immutable hash array mapped trie, keyed by strings
+ *
+ * Every modification returns a new map and leaves the original untouched. The new map shares
+ * all nodes with the original except the ones on the path to the modified key, so a modification
+ * costs O(log32 n) memory and time. Maps can be copied and read concurrently without locking.
+ *
+ * @tparam Value
+ */
+template <class Value>
+class PersistentHashMap
+{
+public:
+  typedef std::shared_ptr<const Value> ValuePtr;
+
+  PersistentHashMap()
+  : size_(0)
+  {}
+
+  size_t size() const {return size_;}
+
+  bool empty() const {return size_ == 0;}
+
+  /**
+   * @brief Get the value of a key
+   *
+   * @param key
+   * @return ValuePtr null if the key does not exist
+   */
+  ValuePtr find(const std::string& key) const
+  {
+    const size_t hash = std::hash<std::string>()(key);
+    const Node* node = root_.get();
+    for (unsigned int depth = 0; node; depth++)
+    {
+      if (depth >= MAX_DEPTH)
+      {
+        for (const Slot& slot : node->slots)
+        {
+          if (slot.leaf->key == key)
+          {
+            return slot.leaf->value;
+          }
+        }
+        return nullptr;
+      }
+
+      const uint32_t bit = uint32_t(1) << fragment(hash, depth);
+      if (!(node->bitmap & bit))
+      {
+        return nullptr;
+      }
+      const Slot& slot = node->slots[position(node->bitmap, bit)];
+      if (slot.leaf)
+      {
+        return slot.leaf->key == key ? slot.leaf->value : nullptr;
+      }
+      node = slot.node.get();
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Get a map where the key has the given value
+   *
+   * @param key
+   * @param value
+   * @return PersistentHashMap
+   */
+  PersistentHashMap insert(const std::string& key, ValuePtr value) const
+  {
+    LeafPtr leaf = std::make_shared<const Leaf>(Leaf{std::hash<std::string>()(key), key, std::move(value)});
+    bool added = false;
+    PersistentHashMap result;
+    result.root_ = insert(root_, 0, leaf, added);
+    result.size_ = size_ + (added ? 1 : 0);
+    return result;
+  }
+
+  /**
+   * @brief Get a map without the key
+   *
+   * @param key
+   * @return PersistentHashMap
+   */
+  PersistentHashMap erase(const std::string& key) const
+  {
+    bool removed = false;
+    NodePtr root = erase(root_, 0, std::hash<std::string>()(key), key, removed);
+    if (!removed)
+    {
+      return *this;
+    }
+    PersistentHashMap result;
+    result.root_ = root;
+    result.size_ = size_ - 1;
+    return result;
+  }
+
+  /**
+   * @brief Visit all entries in an unspecified order
+   *
+   * @tparam Visitor callable that takes (const std::string& key, const Value& value)
+   * @param visitor
+   */
+  template <class Visitor>
+  void forEach(Visitor visitor) const
+  {
+    forEach(root_.get(), visitor);
+  }
+
+private:
+  struct Leaf
+  {
+    size_t hash;
+    std::string key;
+    ValuePtr value;
+  };
+
+  struct Node;
+  typedef std::shared_ptr<const Leaf> LeafPtr;
+  typedef std::shared_ptr<const Node> NodePtr;
+
+  /// Either a leaf or a sub-node
+  struct Slot
+  {
+    LeafPtr leaf;
+    NodePtr node;
+  };
+
+  /// Nodes at MAX_DEPTH have run out of hash bits, they hold colliding leaves and no bitmap
+  struct Node
+  {
+    uint32_t bitmap = 0;
+    std::vector<Slot> slots;
+  };
+
+  static constexpr unsigned int BITS = 5;
+  static constexpr unsigned int MAX_DEPTH = (sizeof(size_t) * 8 + BITS - 1) / BITS;
+
+  static unsigned int fragment(size_t hash, unsigned int depth)
+  {
+    return (hash >> (depth * BITS)) & ((1u << BITS) - 1);
+  }
+
+  static size_t position(uint32_t bitmap, uint32_t bit)
+  {
+    return __builtin_popcount(bitmap & (bit - 1));
+  }
+
+  static NodePtr insert(const NodePtr& node, unsigned int depth, const LeafPtr& leaf, bool& added)
+  {
+    std::shared_ptr<Node> copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+    if (depth >= MAX_DEPTH)
+    {
+      for (Slot& slot : copy->slots)
+      {
+        if (slot.leaf->key == leaf->key)
+        {
+          slot.leaf = leaf;
+          return copy;
+        }
+      }
+      copy->slots.push_back(Slot{leaf, nullptr});
+      added = true;
+      return copy;
+    }
+
+    const uint32_t bit = uint32_t(1) << fragment(leaf->hash, depth);
+    const size_t pos = position(copy->bitmap, bit);
+    if (!(copy->bitmap & bit))
+    {
+      copy->bitmap |= bit;
+      copy->slots.insert(copy->slots.begin() + pos, Slot{leaf, nullptr});
+      added = true;
+      return copy;
+    }
+
+    Slot& slot = copy->slots[pos];
+    if (slot.node)
+    {
+      slot.node = insert(slot.node, depth + 1, leaf, added);
+    }
+    else if (slot.leaf->key == leaf->key)
+    {
+      slot.leaf = leaf;
+    }
+    else
+    {
+      // Two keys share the hash fragment, push both of them one level down
+      bool existing_added = false;
+      NodePtr child = insert(nullptr, depth + 1, slot.leaf, existing_added);
+      slot.node = insert(child, depth + 1, leaf, added);
+      slot.leaf = nullptr;
+    }
+    return copy;
+  }
+
+  static NodePtr erase(const NodePtr& node,
+                       unsigned int depth,
+                       size_t hash,
+                       const std::string& key,
+                       bool& removed)
+  {
+    if (!node)
+    {
+      return node;
+    }
+
+    size_t pos = 0;
+    NodePtr child;
+    if (depth >= MAX_DEPTH)
+    {
+      while (pos < node->slots.size() && node->slots[pos].leaf->key != key)
+      {
+        pos++;
+      }
+      if (pos == node->slots.size())
+      {
+        return node;
+      }
+      removed = true;
+    }
+    else
+    {
+      const uint32_t bit = uint32_t(1) << fragment(hash, depth);
+      if (!(node->bitmap & bit))
+      {
+        return node;
+      }
+      pos = position(node->bitmap, bit);
+      const Slot& slot = node->slots[pos];
+      if (slot.leaf)
+      {
+        if (slot.leaf->key != key)
+        {
+          return node;
+        }
+        removed = true;
+      }
+      else
+      {
+        child = erase(slot.node, depth + 1, hash, key, removed);
+        if (!removed)
+        {
+          return node;
+        }
+      }
+    }
+
+    std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+    if (child)
+    {
+      // A sub-node that is left with a single leaf is replaced by the leaf
+      if (child->slots.size() == 1 && child->slots[0].leaf)
+      {
+        copy->slots[pos] = Slot{child->slots[0].leaf, nullptr};
+      }
+      else
+      {
+        copy->slots[pos].node = child;
+      }
+      return copy;
+    }
+
+    copy->slots.erase(copy->slots.begin() + pos);
+    if (depth < MAX_DEPTH)
+    {
+      copy->bitmap &= ~(uint32_t(1) << fragment(hash, depth));
+    }
+    return copy->slots.empty() ? nullptr : copy;
+  }
+
+  template <class Visitor>
+  static void forEach(const Node* node, Visitor& visitor)
+  {
+    if (!node)
+    {
+      return;
+    }
+    for (const Slot& slot : node->slots)
+    {
+      if (slot.leaf)
+      {
+        visitor(slot.leaf->key, *slot.leaf->value);
+      }
+      else
+      {
+        forEach(slot.node.get(), visitor);
+      }
+    }
+  }
+
+  NodePtr root_;
+  size_t size_;
+};
+
+} // emr namespace
+
+#endif
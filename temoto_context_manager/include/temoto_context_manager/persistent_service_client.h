@@ -0,0 +1,169 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__PERSISTENT_SERVICE_CLIENT_H
+#define TEMOTO_CONTEXT_MANAGER__PERSISTENT_SERVICE_CLIENT_H
+
+#include <ros/ros.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Service client that keeps its connections open between calls
+ *
+ * A plain ros::ServiceClient looks the service up from the master and connects to it on every
+ * call. This client keeps a small set of persistent connections instead, one per concurrent
+ * caller, and reconnects transparently when a connection has been dropped, e.g. because the
+ * server was restarted. Copies share the connections.
+ */
+class PersistentServiceClient
+{
+public:
+  PersistentServiceClient()
+  : retry_(false)
+  , state_(std::make_shared<State>())
+  {}
+
+  /**
+   * @param nh
+   * @param service_name
+   * @param retry whether a call that lost its connection is made again. The server may have
+   * executed the lost call already, hence only services that can be called twice should be retried
+   */
+  PersistentServiceClient(const ros::NodeHandle& nh, const std::string& service_name, bool retry = true)
+  : nh_(nh)
+  , service_name_(service_name)
+  , retry_(retry)
+  , state_(std::make_shared<State>())
+  {}
+
+  /**
+   * @brief Call the service
+   *
+   * A call that fails because the connection was lost is retried once on a new connection,
+   * unless the retries are disabled.
+   *
+   * @tparam Service
+   * @param srv
+   * @return true on success
+   * @return false if the service is not reachable or the server reported a failure
+   */
+  template <class Service>
+  bool call(Service& srv)
+  {
+    ros::ServiceClient client = acquire<Service>();
+    if (client.call(srv))
+    {
+      release(client);
+      return true;
+    }
+
+    // The server answered, but reported a failure
+    if (client.isValid())
+    {
+      release(client);
+      return false;
+    }
+
+    client.shutdown();
+    if (!retry_)
+    {
+      return false;
+    }
+    client = nh_.serviceClient<Service>(service_name_, true);
+    if (client.call(srv))
+    {
+      release(client);
+      return true;
+    }
+    client.shutdown();
+    return false;
+  }
+
+  /**
+   * @brief Close the idle connections, the following calls connect again
+   */
+  void reset()
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    for (ros::ServiceClient& client : state_->idle_clients)
+    {
+      client.shutdown();
+    }
+    state_->idle_clients.clear();
+  }
+
+  const std::string& getService() const
+  {
+    return service_name_;
+  }
+
+private:
+  /// Idle connections are capped, concurrent callers beyond this connect on demand
+  static constexpr size_t MAX_IDLE_CLIENTS = 8;
+
+  struct State
+  {
+    std::mutex mutex;
+    std::vector<ros::ServiceClient> idle_clients;
+  };
+
+  template <class Service>
+  ros::ServiceClient acquire()
+  {
+    {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      while (!state_->idle_clients.empty())
+      {
+        ros::ServiceClient client = state_->idle_clients.back();
+        state_->idle_clients.pop_back();
+        if (client.isValid())
+        {
+          return client;
+        }
+      }
+    }
+    return nh_.serviceClient<Service>(service_name_, true);
+  }
+
+  void release(ros::ServiceClient& client)
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (state_->idle_clients.size() < MAX_IDLE_CLIENTS)
+    {
+      state_->idle_clients.push_back(client);
+    }
+    else
+    {
+      client.shutdown();
+    }
+  }
+
+  ros::NodeHandle nh_;
+  std::string service_name_;
+  bool retry_;
+  std::shared_ptr<State> state_;
+};
+
+} // temoto_context_manager namespace
+
+#endif
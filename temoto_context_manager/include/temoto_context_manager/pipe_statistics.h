@@ -0,0 +1,114 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef TEMOTO_CONTEXT_MANAGER__PIPE_STATISTICS_H
+#define TEMOTO_CONTEXT_MANAGER__PIPE_STATISTICS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Success rate and load latency of the pipes, used for choosing between the pipes of a
+ * category
+ *
+ * Both are exponentially weighted moving averages, so recent loads count more than the old ones
+ * and a pipe that has become slow or flaky drops in the ranking within a few attempts.
+ */
+class PipeStatistics
+{
+public:
+  struct Entry
+  {
+    double success_rate = 1.0;
+
+    /// Seconds per load attempt, including the failed ones
+    double latency = 0.0;
+
+    unsigned int attempts = 0;
+  };
+
+  /**
+   * @param smoothing weight of the latest load attempt, between 0 and 1
+   */
+  explicit PipeStatistics(double smoothing = 0.3);
+
+  /**
+   * @brief Record the outcome of a pipe load attempt
+   *
+   * @param pipe_name
+   * @param success
+   * @param latency seconds it took to load the pipe or to fail
+   */
+  void record(const std::string& pipe_name, bool success, double latency);
+
+  /**
+   * @brief Get the statistics of a pipe
+   *
+   * @param pipe_name
+   * @return Entry the recorded statistics, or an entry without attempts if the pipe is not known
+   */
+  Entry get(const std::string& pipe_name) const;
+
+  /**
+   * @brief Expected time (seconds) it takes to get the pipe loaded, counting the failed attempts
+   *
+   * Pipes without any attempts cost nothing, so they are tried before the known ones.
+   *
+   * @param pipe_name
+   * @return double
+   */
+  double getExpectedCost(const std::string& pipe_name) const;
+
+  /**
+   * @brief Order pipe names by their expected cost, keeping the given order among equal ones
+   *
+   * @param pipe_names
+   * @return std::vector<size_t> indices of pipe_names, the cheapest first
+   */
+  std::vector<size_t> rank(const std::vector<std::string>& pipe_names) const;
+
+  /**
+   * @brief Read the statistics from a YAML file
+   *
+   * @param path
+   * @return true if the file was read
+   * @return false if it does not exist or could not be parsed
+   */
+  bool load(const std::string& path);
+
+  /**
+   * @brief Write the statistics into a YAML file
+   *
+   * The file is replaced atomically, so a crash during the write keeps the previous statistics.
+   *
+   * @param path
+   * @return true on success
+   */
+  bool save(const std::string& path) const;
+
+private:
+  double smoothing_;
+  std::map<std::string, Entry> entries_;
+};
+
+} // temoto_context_manager namespace
+
+#endif
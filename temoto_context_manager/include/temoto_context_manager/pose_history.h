@@ -0,0 +1,101 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__POSE_HISTORY_H
+#define TEMOTO_CONTEXT_MANAGER__POSE_HISTORY_H
+
+#include <geometry_msgs/PoseStamped.h>
+#include <ros/time.h>
+#include <tf/LinearMath/Quaternion.h>
+#include <tf/LinearMath/Vector3.h>
+
+#include <string>
+#include <vector>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Fixed size ring buffer of timestamped poses
+ *
+ * The buffer is allocated once with room for "capacity" samples, so the memory used per item
+ * does not depend on how often its pose changes. Once the buffer is full, every new sample
+ * replaces the oldest one.
+ */
+class PoseHistory
+{
+public:
+  /**
+   * @brief Construct a new Pose History
+   *
+   * @param capacity maximum number of stored samples
+   * @param horizon samples older than this relative to the newest sample are not used
+   */
+  PoseHistory(size_t capacity, const ros::Duration& horizon);
+
+  /**
+   * @brief Append a sample
+   *
+   * The samples must arrive in time order. A sample that is not newer than the newest stored
+   * sample replaces it if the stamps are equal and is dropped otherwise.
+   *
+   * @param pose
+   */
+  void add(const geometry_msgs::PoseStamped& pose);
+
+  /**
+   * @brief Get the pose at the given time
+   *
+   * The position is interpolated linearly and the orientation spherically between the two
+   * samples around the requested time. Requests after the newest sample get the newest sample,
+   * there is no extrapolation.
+   *
+   * @param stamp
+   * @param pose
+   * @return true on success
+   * @return false if the history is empty or the time is before the oldest usable sample
+   */
+  bool getPoseAt(const ros::Time& stamp, geometry_msgs::PoseStamped& pose) const;
+
+  size_t size() const {return size_;}
+
+private:
+  struct Sample
+  {
+    ros::Time stamp;
+    tf::Vector3 position;
+    tf::Quaternion orientation;
+  };
+
+  /// i-th oldest sample
+  const Sample& at(size_t i) const
+  {
+    return samples_[(head_ + capacity_ - size_ + i) % capacity_];
+  }
+
+  std::vector<Sample> samples_;
+  size_t capacity_;
+  ros::Duration horizon_;
+
+  /// Index where the next sample is written
+  size_t head_;
+  size_t size_;
+  std::string frame_id_;
+};
+
+} // temoto_context_manager namespace
+
+#endif
@@ -0,0 +1,149 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__SPATIAL_INDEX_H
+#define TEMOTO_CONTEXT_MANAGER__SPATIAL_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace emr
+{
+
+/**
+ * @brief Uniform hash grid of named points
+ *
+ * Every point is stored in the cell that contains it, and only non-empty cells are kept in
+ * memory. Updating a point is O(1) on average. A query visits only the cells that overlap the
+ * query region. If the region covers more cells than there are points, all points are scanned
+ * instead.
+ */
+class SpatialIndex
+{
+public:
+  struct Position
+  {
+    double x;
+    double y;
+    double z;
+  };
+
+  struct Match
+  {
+    std::string name;
+    Position position;
+    double distance;
+  };
+
+  /**
+   * @brief Construct a new Spatial Index
+   *
+   * @param cell_size edge length of a grid cell. Queries are fastest when it is comparable to
+   * the typical query radius
+   */
+  explicit SpatialIndex(double cell_size = 1.0);
+
+  /**
+   * @brief Add a point or move an existing point
+   *
+   * @param name
+   * @param position
+   */
+  void update(const std::string& name, const Position& position);
+
+  void remove(const std::string& name);
+
+  bool getPosition(const std::string& name, Position& position) const;
+
+  size_t size() const {return entries_.size();}
+
+  /**
+   * @brief Get the points within a radius, sorted by distance
+   *
+   * @param center
+   * @param radius
+   * @return std::vector<Match>
+   */
+  std::vector<Match> radiusSearch(const Position& center, double radius) const;
+
+  /**
+   * @brief Get the points within an axis-aligned box
+   *
+   * @param min_corner
+   * @param max_corner
+   * @return std::vector<Match>
+   */
+  std::vector<Match> boxSearch(const Position& min_corner, const Position& max_corner) const;
+
+  /**
+   * @brief Get the k points nearest to the center, sorted by distance
+   *
+   * @param center
+   * @param k
+   * @return std::vector<Match>
+   */
+  std::vector<Match> nearestSearch(const Position& center, size_t k) const;
+
+private:
+  struct CellKey
+  {
+    int64_t x;
+    int64_t y;
+    int64_t z;
+
+    bool operator==(const CellKey& other) const
+    {
+      return x == other.x && y == other.y && z == other.z;
+    }
+  };
+
+  struct CellKeyHash
+  {
+    size_t operator()(const CellKey& key) const
+    {
+      return (size_t(key.x) * 73856093) ^ (size_t(key.y) * 19349663) ^ (size_t(key.z) * 83492791);
+    }
+  };
+
+  struct Entry
+  {
+    Position position;
+    CellKey cell;
+  };
+
+  typedef std::unordered_map<std::string, Entry> Entries;
+
+  /// Pointers to the elements of entries_, which (unlike iterators) survive rehashing
+  typedef const Entries::value_type* EntryRef;
+
+  CellKey getCellKey(const Position& position) const;
+
+  /**
+   * @brief Call the visitor for every point that may lie within the given cell range
+   */
+  template <class Visitor>
+  void visitCells(const CellKey& min_cell, const CellKey& max_cell, Visitor visitor) const;
+
+  double cell_size_;
+  Entries entries_;
+  std::unordered_map<CellKey, std::vector<EntryRef>, CellKeyHash> cells_;
+};
+
+} // namespace emr
+
+#endif
@@ -0,0 +1,108 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__TIMER_WHEEL_H
+#define TEMOTO_CONTEXT_MANAGER__TIMER_WHEEL_H
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace emr
+{
+
+/**
+ * @brief Hierarchical timing wheel of named deadlines
+ *
+ * Time is measured in integer ticks. Each level of the wheel has 64 slots, a slot of level L
+ * spans 64^L ticks, and a deadline is kept in the lowest level whose range covers it. Whenever
+ * the lower levels wrap around, the due slot of the level above is cascaded down. Scheduling and
+ * cancelling are O(1), and advancing costs O(elapsed ticks + expired and cascaded deadlines),
+ * independent of the number of pending deadlines.
+ */
+class TimerWheel
+{
+public:
+  TimerWheel();
+
+  /**
+   * @brief Set or move the deadline of a name
+   *
+   * Deadlines that are not in the future expire on the next advance(). Deadlines further than
+   * span() ticks away are clamped to span().
+   *
+   * @param name
+   * @param deadline tick
+   */
+  void schedule(const std::string& name, uint64_t deadline);
+
+  void cancel(const std::string& name);
+
+  bool isScheduled(const std::string& name) const;
+
+  size_t size() const {return timers_.size();}
+
+  /**
+   * @brief Advance the wheel and collect the expired names
+   *
+   * The first call only sets the current tick of an empty wheel. If the time jumps further than
+   * span() ticks, all deadlines are rescheduled once.
+   *
+   * @param now tick
+   * @return std::vector<std::string> names whose deadline is not after now, in deadline order
+   */
+  std::vector<std::string> advance(uint64_t now);
+
+  uint64_t currentTick() const {return current_tick_;}
+
+  /// Number of ticks that the wheel can hold
+  static constexpr uint64_t span() {return uint64_t(1) << (SLOT_BITS * LEVELS);}
+
+private:
+  static constexpr unsigned int SLOT_BITS = 6;
+  static constexpr unsigned int SLOTS = 1 << SLOT_BITS;
+  static constexpr unsigned int LEVELS = 4;
+
+  typedef std::list<std::string> Slot;
+
+  struct Timer
+  {
+    uint64_t deadline;
+    Slot* slot;
+    Slot::iterator position;
+  };
+
+  /**
+   * @brief Put a timer into the slot that matches its deadline
+   *
+   * @param timer_it
+   */
+  void place(std::unordered_map<std::string, Timer>::iterator timer_it);
+
+  void cascade(unsigned int level);
+
+  std::array<std::array<Slot, SLOTS>, LEVELS> wheel_;
+  std::unordered_map<std::string, Timer> timers_;
+  uint64_t current_tick_;
+  bool started_;
+};
+
+} // emr namespace
+
+#endif
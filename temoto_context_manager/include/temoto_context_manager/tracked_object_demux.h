@@ -0,0 +1,87 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef TEMOTO_CONTEXT_MANAGER__TRACKED_OBJECT_DEMUX_H
+#define TEMOTO_CONTEXT_MANAGER__TRACKED_OBJECT_DEMUX_H
+
+#include "temoto_context_manager/env_model_interface.h"
+#include <ros/ros.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Routes the detections of a shared tracker to the objects that are tracked with it
+ *
+ * A single tracker publishes everything it detects in the data of a pipe as ObjectContainers.
+ * Detections that carry the name of the object are routed by the name. Otherwise the detection
+ * carries the tag_id and the pose of a tag, the demultiplexer finds the object that carries the
+ * tag and applies its obj_relative_pose. The pose of the object is updated in the EMR and the
+ * object is published on its topic. Detections of objects that are not tracked are dropped.
+ */
+class TrackedObjectDemux
+{
+public:
+  /**
+   * @param nh
+   * @param emr_interface
+   * @param detections_topic where the shared tracker publishes the detections
+   */
+  TrackedObjectDemux(const ros::NodeHandle& nh
+                    , std::shared_ptr<EnvModelInterface> emr_interface
+                    , const std::string& detections_topic);
+
+  /**
+   * @brief Start routing the detections of an object
+   *
+   * @param object_name
+   * @param object_topic where the object is published
+   */
+  void addObject(const std::string& object_name, const std::string& object_topic);
+
+  /**
+   * @brief Stop routing the detections of an object
+   *
+   * @param object_name
+   * @return size_t number of objects that are still routed
+   */
+  size_t removeObject(const std::string& object_name);
+
+  const std::string& getDetectionsTopic() const;
+
+private:
+  void detectionCb(const ObjectContainer::ConstPtr& detection);
+
+  ros::NodeHandle nh_;
+  std::shared_ptr<EnvModelInterface> emr_interface_;
+  std::string detections_topic_;
+  ros::Subscriber detections_subscriber_;
+
+  std::mutex objects_mutex_;
+
+  /// Publishers of the routed objects, by object name
+  std::map<std::string, ros::Publisher> object_publishers_;
+};
+
+} // temoto_context_manager namespace
+
+#endif
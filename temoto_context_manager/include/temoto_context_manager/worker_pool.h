@@ -0,0 +1,121 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef TEMOTO_CONTEXT_MANAGER__WORKER_POOL_H
+#define TEMOTO_CONTEXT_MANAGER__WORKER_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace temoto_context_manager
+{
+
+/**
+ * @brief Fixed-size pool of threads that run submitted tasks in FIFO order
+ *
+ * The threads are started with the first submitted task. The destructor finishes the tasks
+ * that are already queued before joining the threads.
+ */
+class WorkerPool
+{
+public:
+  explicit WorkerPool(size_t thread_count)
+  : thread_count_(thread_count > 0 ? thread_count : 1)
+  , stopping_(false)
+  {}
+
+  ~WorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread& thread : threads_)
+    {
+      thread.join();
+    }
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /**
+   * @brief Queue a task
+   *
+   * @tparam Task callable without arguments
+   * @param task
+   * @return std::future that holds the result of the task, or the exception it threw
+   */
+  template <class Task>
+  std::future<typename std::result_of<Task()>::type> submit(Task task)
+  {
+    typedef typename std::result_of<Task()>::type Result;
+    auto packaged_task = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    std::future<Result> result = packaged_task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (threads_.empty())
+      {
+        for (size_t i = 0; i < thread_count_; i++)
+        {
+          threads_.emplace_back(&WorkerPool::run, this);
+        }
+      }
+      tasks_.emplace_back([packaged_task]{(*packaged_task)();});
+    }
+    cv_.notify_one();
+    return result;
+  }
+
+private:
+  void run()
+  {
+    while (true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]{return stopping_ || !tasks_.empty();});
+        if (tasks_.empty())
+        {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  size_t thread_count_;
+  bool stopping_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  std::vector<std::thread> threads_;
+};
+
+} // temoto_context_manager namespace
+
+#endif
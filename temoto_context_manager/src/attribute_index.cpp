@@ -0,0 +1,136 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "temoto_context_manager/attribute_index.h"
+
+#include <algorithm>
+
+namespace emr
+{
+
+void AttributeIndex::update(const std::string& name, Attributes attributes)
+{
+  std::sort(attributes.begin(), attributes.end());
+  attributes.erase(std::unique(attributes.begin(), attributes.end()), attributes.end());
+
+  auto item_it = item_attributes_.find(name);
+  if (item_it != item_attributes_.end())
+  {
+    // Most updates only move the item, in which case the postings stay as they are
+    if (item_it->second == attributes)
+    {
+      return;
+    }
+    remove(name);
+  }
+
+  for (const auto& attribute : attributes)
+  {
+    postings_[attribute].insert(name);
+  }
+  item_attributes_.emplace(name, std::move(attributes));
+}
+
+void AttributeIndex::remove(const std::string& name)
+{
+  auto item_it = item_attributes_.find(name);
+  if (item_it == item_attributes_.end())
+  {
+    return;
+  }
+
+  for (const auto& attribute : item_it->second)
+  {
+    auto posting_it = postings_.find(attribute);
+    if (posting_it == postings_.end())
+    {
+      continue;
+    }
+    posting_it->second.erase(name);
+    if (posting_it->second.empty())
+    {
+      postings_.erase(posting_it);
+    }
+  }
+  item_attributes_.erase(item_it);
+}
+
+std::vector<std::string> AttributeIndex::query(const Attributes& constraints,
+                                               const std::string& after,
+                                               size_t limit,
+                                               const Filter& filter) const
+{
+  std::vector<std::string> names;
+  if (limit == 0)
+  {
+    return names;
+  }
+
+  // Walk the shortest posting list and test the names against the others
+  std::vector<const std::set<std::string>*> postings;
+  const std::set<std::string>* shortest = nullptr;
+  for (const auto& constraint : constraints)
+  {
+    const auto posting_it = postings_.find(constraint);
+    if (posting_it == postings_.end())
+    {
+      return names;
+    }
+    postings.push_back(&posting_it->second);
+    if (!shortest || posting_it->second.size() < shortest->size())
+    {
+      shortest = &posting_it->second;
+    }
+  }
+
+  auto matches = [&](const std::string& name)
+  {
+    for (const auto* posting : postings)
+    {
+      if (posting != shortest && posting->count(name) == 0)
+      {
+        return false;
+      }
+    }
+    return !filter || filter(name);
+  };
+
+  if (shortest)
+  {
+    for (auto name_it = shortest->upper_bound(after); name_it != shortest->end() && names.size() < limit; ++name_it)
+    {
+      if (matches(*name_it))
+      {
+        names.push_back(*name_it);
+      }
+    }
+  }
+  else
+  {
+    for (auto item_it = item_attributes_.upper_bound(after);
+         item_it != item_attributes_.end() && names.size() < limit;
+         ++item_it)
+    {
+      if (matches(item_it->first))
+      {
+        names.push_back(item_it->first);
+      }
+    }
+  }
+  return names;
+}
+
+} // namespace emr
@@ -23,10 +23,55 @@
 #include <utility>
 #include <yaml-cpp/yaml.h>
 #include <fstream>
+#include <cstdlib>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <sstream>
 
 namespace temoto_context_manager
 {
 
+/**
+ * @brief Measures the durations of consecutive startup phases
+ */
+class StartupTrace
+{
+public:
+  StartupTrace()
+  : start_time_(ros::WallTime::now())
+  , phase_start_time_(start_time_)
+  {}
+
+  /**
+   * @brief Mark the end of the current phase, the next phase starts right away
+   * 
+   * @param phase_name 
+   */
+  void endPhase(const std::string& phase_name)
+  {
+    ros::WallTime now = ros::WallTime::now();
+    phases_.emplace_back(phase_name, (now - phase_start_time_).toSec() * 1000);
+    phase_start_time_ = now;
+  }
+
+  std::string summary() const
+  {
+    std::stringstream ss;
+    ss << (phase_start_time_ - start_time_).toSec() * 1000 << " ms total";
+    for (const auto& phase : phases_)
+    {
+      ss << ", " << phase.first << ": " << phase.second << " ms";
+    }
+    return ss.str();
+  }
+
+private:
+  ros::WallTime start_time_;
+  ros::WallTime phase_start_time_;
+  std::vector<std::pair<std::string, double>> phases_;
+};
+
 ContextManager::ContextManager()
   : temoto_core::BaseSubsystem("temoto_context_manager", temoto_core::error::Subsystem::CONTEXT_MANAGER, __func__)
   , resource_registrar_1_(srv_name::MANAGER, this)
@@ -34,31 +79,184 @@ ContextManager::ContextManager()
   , tracked_objects_syncer_(srv_name::MANAGER, srv_name::SYNC_TRACKED_OBJECTS_TOPIC, &ContextManager::trackedObjectsSyncCb, this)
   , emr_syncer_(srv_name::MANAGER, srv_name::SYNC_OBJECTS_TOPIC, &ContextManager::emrSyncCb, this)
   , action_engine_()
+  , action_engine_ready_(action_engine_ready_promise_.get_future().share())
 {
+  StartupTrace startup_trace;
+
   /*
-   * Set up the action engine
-   */ 
-  std::string action_uri_file_path = ros::package::getPath(ROS_PACKAGE_NAME) + "/config/action_dst.yaml";
+   * Read the EMR synchronization settings
+   */
+  std::string emr_sync_mode;
+  double emr_peer_timeout;
+  ros::param::param<std::string>("~emr_sync_mode", emr_sync_mode, "full");
+  ros::param::param<double>("~emr_peer_timeout", emr_peer_timeout, 5.0);
+  emr_peer_timeout_ = ros::Duration(emr_peer_timeout);
+
+  if (emr_sync_mode == "owner_partitioned")
+  {
+    emr_sync_mode_ = EmrSyncMode::OWNER_PARTITIONED;
+  }
+  else
+  {
+    if (emr_sync_mode != "full")
+    {
+      TEMOTO_WARN_STREAM("Unknown EMR sync mode '" << emr_sync_mode << "', falling back to 'full'");
+    }
+    emr_sync_mode_ = EmrSyncMode::FULL;
+  }
+  TEMOTO_INFO_STREAM("Using '" << emr_sync_mode << "' EMR synchronization mode");
+
+  /*
+   * Read the sizes of the thread pools that serve the callback queues
+   */
+  int query_threads;
+  int mutation_threads;
+  int sync_threads;
+  ros::param::param<int>("~query_threads", query_threads, 4);
+  ros::param::param<int>("~mutation_threads", mutation_threads, 1);
+  ros::param::param<int>("~sync_threads", sync_threads, 1);
+
+  /*
+   * Read how many pipes are loaded concurrently when an object is tracked. The first pipe that
+   * is loaded is used and the rest are unloaded, 1 tries the pipes one by one
+   */
+  ros::param::param<int>("~speculative_pipe_loads", speculative_pipe_loads_, 1);
+  speculative_pipe_loads_ = std::max(speculative_pipe_loads_, 1);
+
+  /*
+   * Read the detection methods whose objects share a single tracker per pipe, which routes the
+   * detections to the objects by their name or tag, e.g. ["artags"]. The tracker actions of the
+   * listed methods have to publish all of their detections when no object name is given to them.
+   * Empty by default, then every object gets a tracker of its own
+   */
+  ros::param::param<std::vector<std::string>>("~demux_detection_methods", demux_detection_methods_,
+    std::vector<std::string>{});
 
-  // Open the action sources yaml file and get the paths to action libs
-  // TODO: check for typos and other existance problems
-  YAML::Node config = YAML::LoadFile(action_uri_file_path);
-  TEMOTO_INFO_STREAM("Indexing TeMoto actions");
-  for (YAML::const_iterator it = config.begin(); it != config.end(); ++it)
+  /*
+   * Read the edge length of the spatial index cells. Queries are fastest when it is comparable to
+   * the typical query radius
+   */
+  double emr_spatial_cell_size;
+  ros::param::param<double>("~emr_spatial_cell_size", emr_spatial_cell_size, 1.0);
+
+  /*
+   * Read the length (number of poses per item) and the horizon (seconds) of the pose history
+   */
+  int emr_pose_history_length;
+  double emr_pose_history_horizon;
+  ros::param::param<int>("~emr_pose_history_length", emr_pose_history_length, 100);
+  ros::param::param<double>("~emr_pose_history_horizon", emr_pose_history_horizon, 10.0);
+
+  /*
+   * Read how long (seconds) the replaced EMR versions are kept, 0 disables the history
+   */
+  double emr_history_retention;
+  int emr_history_max_versions;
+  ros::param::param<double>("~emr_history_retention", emr_history_retention, 0.0);
+  ros::param::param<int>("~emr_history_max_versions", emr_history_max_versions, 100000);
+
+  /*
+   * Read the time-to-live (seconds) of the EMR items, keyed by container type (e.g. OBJECT) or
+   * item name, and whether stale items are only flagged ("stale") or removed ("expire")
+   */
+  std::map<std::string, double> emr_ttl;
+  std::string emr_ttl_mode;
+  double emr_ttl_resolution;
+  ros::param::get("~emr_ttl", emr_ttl);
+  ros::param::param<std::string>("~emr_ttl_mode", emr_ttl_mode, "stale");
+  ros::param::param<double>("~emr_ttl_resolution", emr_ttl_resolution, 0.1);
+  if (emr_ttl_mode != "stale" && emr_ttl_mode != "expire")
+  {
+    TEMOTO_WARN_STREAM("Unknown EMR TTL mode '" << emr_ttl_mode << "', falling back to 'stale'");
+    emr_ttl_mode = "stale";
+  }
+
+  /*
+   * Read the EMR snapshot settings. By default the snapshot is kept in the ROS home directory
+   */
+  std::string default_snapshot_dir = std::getenv("ROS_HOME") ? std::getenv("ROS_HOME")
+                                   : std::getenv("HOME") ? std::string(std::getenv("HOME")) + "/.ros"
+                                   : std::string("/tmp");
+  std::string snapshot_name = temoto_core::common::getTemotoNamespace();
+  std::replace(snapshot_name.begin(), snapshot_name.end(), '/', '_');
+  double emr_snapshot_period;
+  ros::param::param<std::string>("~emr_snapshot_path", emr_snapshot_path_,
+    default_snapshot_dir + "/temoto_context_manager" + snapshot_name + ".emr");
+  ros::param::param<double>("~emr_snapshot_period", emr_snapshot_period, 10.0);
+
+  // The write-ahead log is kept next to the snapshot
+  int emr_wal_segment_size;
+  double emr_wal_sync_period;
+  ros::param::param<std::string>("~emr_wal_directory", emr_wal_directory_,
+    emr_snapshot_path_.empty() ? std::string() : emr_snapshot_path_ + ".wal");
+  ros::param::param<int>("~emr_wal_segment_size", emr_wal_segment_size, 16 * 1024 * 1024);
+  ros::param::param<double>("~emr_wal_sync_period", emr_wal_sync_period, 0.05);
+  if (!emr_wal_directory_.empty())
   {
-    std::string package_name = (*it)["package_name"].as<std::string>();
-    std::string relative_path = (*it)["relative_path"].as<std::string>();
-    std::string full_path = ros::package::getPath(package_name) + "/" + relative_path;
-    action_engine_.addActionsPath(full_path);
+    emr_wal_ = std::make_shared<EmrWriteAheadLog>(emr_wal_directory_, emr_wal_segment_size, emr_wal_sync_period);
   }
 
-  // Start the Action Engine
-  action_engine_.start();
+  /*
+   * Read where same-host readers can map the latest EMR snapshot (empty disables the export),
+   * the maximum size of the snapshot and how often it is refreshed
+   */
+  std::string emr_shm_name;
+  int emr_shm_capacity;
+  double emr_shm_period;
+  ros::param::param<std::string>("~emr_shm_name", emr_shm_name, "");
+  ros::param::param<int>("~emr_shm_capacity", emr_shm_capacity, 64 * 1024 * 1024);
+  ros::param::param<double>("~emr_shm_period", emr_shm_period, 0.05);
+  if (!emr_shm_name.empty())
+  {
+    emr_shm_writer_.reset(new EmrSharedMemoryWriter(emr_shm_name, std::max(emr_shm_capacity, 0)));
+  }
+
+  /*
+   * Read where the success rates and load latencies of the pipes are kept between restarts
+   * (empty disables it). They are used for choosing between the pipes of a category. The file is
+   * written periodically when the statistics have changed, and at shutdown
+   */
+  double pipe_statistics_period;
+  ros::param::param<std::string>("~pipe_statistics_path", pipe_statistics_path_,
+    default_snapshot_dir + "/temoto_context_manager" + snapshot_name + ".pipes.yaml");
+  ros::param::param<double>("~pipe_statistics_period", pipe_statistics_period, 10.0);
+  if (!pipe_statistics_path_.empty() && component_to_emr_registry_.loadPipeStatistics(pipe_statistics_path_))
+  {
+    TEMOTO_INFO_STREAM("Restored the pipe statistics from " << pipe_statistics_path_);
+  }
+
+  nh_query_.setCallbackQueue(&query_cb_queue_);
+  nh_mutation_.setCallbackQueue(&mutation_cb_queue_);
+  nh_sync_.setCallbackQueue(&sync_cb_queue_);
+
+  startup_trace.endPhase("parameters");
 
   /*
    * Initialize the Environment Model Repository interface
    */
-  emr_interface = std::make_shared<emr_ros_interface::EmrRosInterface>(env_model_repository_, temoto_core::common::getTemotoNamespace());
+  emr_ros_interface_ = std::make_shared<emr_ros_interface::EmrRosInterface>(env_model_repository_
+                                                                       , temoto_core::common::getTemotoNamespace()
+                                                                       , emr_spatial_cell_size);
+  emr_interface = emr_ros_interface_;
+  emr_ros_interface_->configurePoseHistory(std::max(emr_pose_history_length, 0), emr_pose_history_horizon);
+  emr_ros_interface_->configureTtl(emr_ttl, emr_ttl_mode == "expire", emr_ttl_resolution);
+  emr_ros_interface_->configureHistory(emr_history_retention, std::max(emr_history_max_versions, 1));
+
+  // Restore the EMR from the last snapshot and the write-ahead log before anybody can query it
+  restoreEmr();
+  startup_trace.endPhase("EMR restore");
+
+  // Publish the EMR modifications to the clients that watch them or cache the items. A watch
+  // whose client does not subscribe within ~emr_watch_subscribe_timeout seconds is dropped
+  double emr_watch_subscribe_timeout;
+  ros::param::param<double>("~emr_watch_subscribe_timeout", emr_watch_subscribe_timeout, 30.0);
+  emr_watch_manager_.reset(new EmrWatchManager(nh_, emr_interface, ros::WallDuration(emr_watch_subscribe_timeout)));
+  emr_invalidation_pub_ = nh_.advertise<EmrInvalidation>(srv_name::EMR_INVALIDATION_TOPIC, 1000);
+  emr_ros_interface_->setChangeCallback(std::bind(&ContextManager::emrChangeCb
+                                                 , this
+                                                 , std::placeholders::_1
+                                                 , std::placeholders::_2
+                                                 , std::placeholders::_3));
   
   /*
    * Start the servers
@@ -68,6 +266,9 @@ ContextManager::ContextManager()
   resource_registrar_1_.addServer<TrackObject>(srv_name::TRACK_OBJECT_SERVER
                                             , &ContextManager::loadTrackObjectCb
                                             , &ContextManager::unloadTrackObjectCb);
+  resource_registrar_1_.addServer<TrackObjects>(srv_name::TRACK_OBJECTS_SERVER
+                                             , &ContextManager::loadTrackObjectsCb
+                                             , &ContextManager::unloadTrackObjectsCb);
 
   // Register callback for status info
   resource_registrar_1_.registerStatusCb(&ContextManager::statusCb1);
@@ -75,21 +276,313 @@ ContextManager::ContextManager()
 
   // "Update EMR" 
   TEMOTO_INFO("Starting the EMR update server");
-  update_emr_server_ = nh_.advertiseService(srv_name::SERVER_UPDATE_EMR, &ContextManager::updateEmrCb, this);
-  get_emr_item_server_ = nh_.advertiseService(srv_name::SERVER_GET_EMR_ITEM, &ContextManager::getEmrItemCb, this);
-
-  get_emr_vector_server_ = nh_.advertiseService(srv_name::SERVER_GET_EMR_VECTOR, &ContextManager::getEmrVectorCb, this);
+  update_emr_server_ = nh_mutation_.advertiseService(srv_name::SERVER_UPDATE_EMR, &ContextManager::updateEmrCb, this);
+  get_emr_item_server_ = nh_query_.advertiseService(srv_name::SERVER_GET_EMR_ITEM, &ContextManager::getEmrItemCb, this);
+  get_emr_items_server_ = nh_query_.advertiseService(srv_name::SERVER_GET_EMR_ITEMS, &ContextManager::getEmrItemsCb, this);
+  get_emr_items_in_region_server_ = nh_query_.advertiseService(srv_name::SERVER_GET_EMR_ITEMS_IN_REGION
+                                                              , &ContextManager::getEmrItemsInRegionCb
+                                                              , this);
+  get_emr_world_poses_server_ = nh_query_.advertiseService(srv_name::SERVER_GET_EMR_WORLD_POSES
+                                                          , &ContextManager::getEmrWorldPosesCb
+                                                          , this);
+  query_emr_server_ = nh_query_.advertiseService(srv_name::SERVER_QUERY_EMR, &ContextManager::queryEmrCb, this);
+  watch_emr_server_ = nh_query_.advertiseService(srv_name::SERVER_WATCH_EMR, &ContextManager::watchEmrCb, this);
+  unwatch_emr_server_ = nh_query_.advertiseService(srv_name::SERVER_UNWATCH_EMR, &ContextManager::unwatchEmrCb, this);
+  get_emr_objects_by_tag_server_ = nh_query_.advertiseService(srv_name::SERVER_GET_EMR_OBJECTS_BY_TAG
+                                                             , &ContextManager::getEmrObjectsByTagCb
+                                                             , this);
+  get_emr_poses_at_server_ = nh_query_.advertiseService(srv_name::SERVER_GET_EMR_POSES_AT, &ContextManager::getEmrPosesAtCb, this);
+  get_emr_at_server_ = nh_query_.advertiseService(srv_name::SERVER_GET_EMR_AT, &ContextManager::getEmrAtCb, this);
+  pin_emr_version_server_ = nh_query_.advertiseService(srv_name::SERVER_PIN_EMR_VERSION, &ContextManager::pinEmrVersionCb, this);
+  ping_server_ = nh_query_.advertiseService(srv_name::SERVER_PING, &ContextManager::pingCb, this);
+
+  get_emr_vector_server_ = nh_query_.advertiseService(srv_name::SERVER_GET_EMR_VECTOR, &ContextManager::getEmrVectorCb, this);
+  startup_trace.endPhase("servers");
   
   // Request remote EMR configurations
   emr_syncer_.requestRemoteConfigs();
+  startup_trace.endPhase("remote EMR request");
 
-  emr_sync_timer = nh_.createTimer(ros::Duration(1), &ContextManager::timerCallback, this);
+  emr_sync_timer = nh_sync_.createTimer(ros::Duration(1), &ContextManager::timerCallback, this);
 
-  // Start the component-to-EMR linker actions
-  TEMOTO_INFO("Starting the component-to-emr-item linker ...");
-  startComponentToEmrLinker();
-  
-  TEMOTO_INFO("Context Manager is ready.");
+  if (emr_shm_writer_ && emr_shm_writer_->isOpen() && emr_shm_period > 0)
+  {
+    emr_shm_timer_ = nh_sync_.createTimer(ros::Duration(emr_shm_period), &ContextManager::emrShmTimerCallback, this);
+  }
+
+  if (!emr_snapshot_path_.empty() && emr_snapshot_period > 0)
+  {
+    emr_snapshot_timer_ = nh_sync_.createTimer(ros::Duration(emr_snapshot_period)
+                                              , &ContextManager::emrSnapshotTimerCallback
+                                              , this);
+  }
+
+  if (!pipe_statistics_path_.empty() && pipe_statistics_period > 0)
+  {
+    pipe_statistics_timer_ = nh_sync_.createTimer(ros::Duration(pipe_statistics_period)
+                                                 , &ContextManager::pipeStatisticsTimerCallback
+                                                 , this);
+  }
+
+  // Start serving the callback queues
+  query_spinner_.reset(new ros::AsyncSpinner(query_threads, &query_cb_queue_));
+  mutation_spinner_.reset(new ros::AsyncSpinner(mutation_threads, &mutation_cb_queue_));
+  sync_spinner_.reset(new ros::AsyncSpinner(sync_threads, &sync_cb_queue_));
+  query_spinner_->start();
+  mutation_spinner_->start();
+  sync_spinner_->start();
+  startup_trace.endPhase("spinners");
+
+  /*
+   * The EMR is usable at this point. The actions are indexed and the action engine is started in
+   * the background, object tracking requests wait until that is done
+   */
+  TEMOTO_INFO_STREAM("EMR services are up. Startup: " << startup_trace.summary());
+  action_engine_thread_ = std::thread(&ContextManager::startActionEngine, this);
+}
+
+void ContextManager::startActionEngine()
+{
+  StartupTrace startup_trace;
+  try
+  {
+    /*
+     * Set up the action engine
+     */ 
+    std::string action_uri_file_path = ros::package::getPath(ROS_PACKAGE_NAME) + "/config/action_dst.yaml";
+
+    // Open the action sources yaml file and get the paths to action libs
+    // TODO: check for typos and other existance problems
+    YAML::Node config = YAML::LoadFile(action_uri_file_path);
+    TEMOTO_INFO_STREAM("Indexing TeMoto actions");
+
+    // Resolving the package paths is slow, hence it is done for all packages in parallel
+    std::vector<std::future<std::string>> action_paths;
+    for (YAML::const_iterator it = config.begin(); it != config.end(); ++it)
+    {
+      std::string package_name = (*it)["package_name"].as<std::string>();
+      std::string relative_path = (*it)["relative_path"].as<std::string>();
+      action_paths.push_back(std::async(std::launch::async, [package_name, relative_path]
+      {
+        return ros::package::getPath(package_name) + "/" + relative_path;
+      }));
+    }
+    std::vector<std::string> resolved_action_paths;
+    for (auto& action_path : action_paths)
+    {
+      resolved_action_paths.push_back(action_path.get());
+    }
+    startup_trace.endPhase("action path resolution");
+
+    for (const auto& action_path : resolved_action_paths)
+    {
+      action_engine_.addActionsPath(action_path);
+    }
+    startup_trace.endPhase("action indexing");
+
+    // Start the Action Engine
+    action_engine_.start();
+    startup_trace.endPhase("action engine start");
+
+    // Start the component-to-EMR linker actions
+    TEMOTO_INFO("Starting the component-to-emr-item linker ...");
+    startComponentToEmrLinker();
+    startup_trace.endPhase("component-to-emr linker");
+  }
+  catch (temoto_core::error::ErrorStack& error_stack)
+  {
+    TEMOTO_ERROR_STREAM("Failed to start the action engine");
+    action_engine_ready_promise_.set_exception(std::make_exception_ptr(FORWARD_ERROR(error_stack)));
+    return;
+  }
+  catch (std::exception& e)
+  {
+    TEMOTO_ERROR_STREAM("Failed to start the action engine: " << e.what());
+    action_engine_ready_promise_.set_exception(std::make_exception_ptr(
+      CREATE_ERROR(temoto_core::error::Code::UNHANDLED_EXCEPTION, std::string("Failed to start the action engine: ") + e.what())));
+    return;
+  }
+
+  action_engine_ready_promise_.set_value();
+  TEMOTO_INFO_STREAM("Context Manager is ready. Action engine startup: " << startup_trace.summary());
+}
+
+/*
+ * Wait for the action engine
+ */
+void ContextManager::waitForActionEngine()
+{
+  try
+  {
+    action_engine_ready_.get();
+  }
+  catch (temoto_core::error::ErrorStack& error_stack)
+  {
+    throw FORWARD_ERROR(error_stack);
+  }
+}
+
+ContextManager::~ContextManager()
+{
+  if (action_engine_thread_.joinable())
+  {
+    action_engine_thread_.join();
+  }
+
+  // Wait for the speculative pipe loads that are still unloading their pipes
+  {
+    std::lock_guard<std::mutex> lock(pipe_loads_mutex_);
+    pipe_loads_.clear();
+  }
+
+  // Stop serving the requests, so that the EMR is not modified while it is being saved
+  emr_snapshot_timer_.stop();
+  emr_shm_timer_.stop();
+  pipe_statistics_timer_.stop();
+  if (mutation_spinner_)
+  {
+    mutation_spinner_->stop();
+  }
+  if (sync_spinner_)
+  {
+    sync_spinner_->stop();
+  }
+  if (query_spinner_)
+  {
+    query_spinner_->stop();
+  }
+  saveEmrSnapshot();
+  savePipeStatistics();
+
+  // The EMR interface may outlive the watch manager
+  emr_ros_interface_->setChangeCallback(nullptr);
+}
+
+void ContextManager::restoreEmr()
+{
+  ros::WallTime start_time = ros::WallTime::now();
+  uint64_t snapshot_sequence = 0;
+
+  if (!emr_snapshot_path_.empty())
+  {
+    Items snapshot_items;
+    if (EmrSnapshot::read(emr_snapshot_path_, snapshot_items, snapshot_sequence))
+    {
+      // The snapshot items are restored as they were, hence they are not advertised nor re-stamped
+      Items failed_items = updateEmr(snapshot_items, true);
+      TEMOTO_INFO_STREAM("Restored " << snapshot_items.size() - failed_items.size() << " EMR items from "
+        << emr_snapshot_path_);
+      if (!failed_items.empty())
+      {
+        TEMOTO_WARN_STREAM("Failed to restore " << failed_items.size() << " EMR items from " << emr_snapshot_path_);
+      }
+    }
+    else
+    {
+      TEMOTO_INFO_STREAM("No EMR snapshot was loaded from " << emr_snapshot_path_);
+    }
+  }
+
+  if (!emr_wal_)
+  {
+    return;
+  }
+
+  size_t replayed = emr_wal_->replay(snapshot_sequence, [&](const EmrWriteAheadLog::Record& record)
+  {
+    if (record.operation == EmrWriteAheadLog::Operation::UPDATE_ITEM)
+    {
+      emr_interface->updateEmr(record.item);
+    }
+    else if (record.operation == EmrWriteAheadLog::Operation::UPDATE_POSE)
+    {
+      if (emr_interface->hasItem(record.name))
+      {
+        emr_interface->updatePose(record.name
+          , temoto_core::deserializeROSmsg<geometry_msgs::PoseStamped>(record.serialized_pose));
+      }
+    }
+    else if (record.operation == EmrWriteAheadLog::Operation::REMOVE_ITEM)
+    {
+      if (emr_interface->hasItem(record.name))
+      {
+        emr_interface->removeItem(record.name);
+      }
+    }
+  });
+  TEMOTO_INFO_STREAM("Replayed " << replayed << " EMR write-ahead log records. Restoring the EMR took "
+    << (ros::WallTime::now() - start_time).toSec() * 1000 << " ms");
+
+  // Start logging the modifications only after the replay, so that the replayed records are not logged twice
+  if (emr_wal_->start())
+  {
+    emr_ros_interface_->setWriteAheadLog(emr_wal_);
+  }
+  else
+  {
+    TEMOTO_ERROR_STREAM("EMR modifications are not logged, the write-ahead log could not be started");
+  }
+}
+
+void ContextManager::saveEmrSnapshot()
+{
+  if (emr_snapshot_path_.empty())
+  {
+    return;
+  }
+
+  /*
+   * The sequence number is read before the EMR is captured. Replaying a few records that are
+   * already included in the snapshot is harmless, since the records are applied in order
+   */
+  uint64_t wal_sequence = emr_wal_ ? emr_wal_->getLastSequence() : 0;
+  if (!EmrSnapshot::write(emr_snapshot_path_, emr_interface->EmrToVector(), wal_sequence))
+  {
+    TEMOTO_ERROR_STREAM("Failed to write the EMR snapshot to " << emr_snapshot_path_);
+    return;
+  }
+
+  // Drop the log segments that are superseded by the new snapshot
+  if (emr_wal_)
+  {
+    emr_wal_->compact(wal_sequence);
+  }
+}
+
+void ContextManager::emrSnapshotTimerCallback(const ros::TimerEvent&)
+{
+  saveEmrSnapshot();
+}
+
+void ContextManager::pipeStatisticsTimerCallback(const ros::TimerEvent&)
+{
+  savePipeStatistics();
+}
+
+void ContextManager::savePipeStatistics()
+{
+  if (pipe_statistics_path_.empty() || !pipe_statistics_dirty_.exchange(false))
+  {
+    return;
+  }
+  if (!component_to_emr_registry_.savePipeStatistics(pipe_statistics_path_))
+  {
+    TEMOTO_ERROR_STREAM("Failed to save the pipe statistics to " << pipe_statistics_path_);
+  }
+}
+
+void ContextManager::emrShmTimerCallback(const ros::TimerEvent&)
+{
+  // The version is read before the items, so a change that lands in between is exported again
+  if (!emr_shm_dirty_.exchange(false))
+  {
+    return;
+  }
+  const uint64_t version = emr_version_;
+  if (!emr_shm_writer_->write(emr_interface->EmrToVector(), version))
+  {
+    TEMOTO_ERROR_STREAM("Failed to export the EMR to the shared memory");
+  }
 }
 
 // TODO: Do we need this? 
@@ -114,7 +607,29 @@ void ContextManager::emrSyncCb(const temoto_core::ConfigSync& msg, const Items&
   if (msg.action == temoto_core::trr::sync_action::ADVERTISE_CONFIG)
   {
     TEMOTO_DEBUG("Received a payload.");
-    updateEmr(payload, true);
+    {
+      std::lock_guard<std::mutex> lock(emr_peers_mutex_);
+      emr_peers_last_seen_[msg.temoto_namespace] = ros::Time::now();
+    }
+
+    if (emr_sync_mode_ == EmrSyncMode::OWNER_PARTITIONED)
+    {
+      // Drop the echoes of the items that are maintained by this manager
+      const std::string own_namespace = temoto_core::common::getTemotoNamespace();
+      Items remote_items;
+      for (const auto& item : payload)
+      {
+        if (item.maintainer != own_namespace)
+        {
+          remote_items.push_back(item);
+        }
+      }
+      updateEmr(remote_items, true);
+    }
+    else
+    {
+      updateEmr(payload, true);
+    }
   }
 }
 
@@ -129,6 +644,7 @@ void ContextManager::trackedObjectsSyncCb(const temoto_core::ConfigSync& msg, co
                         << msg.temoto_namespace << "'.");
 
     // Add a notion about a object that is being tracked
+    std::lock_guard<std::mutex> lock(tracking_mutex_);
     m_tracked_objects_remote_[payload] = msg.temoto_namespace;
   }
   else
@@ -138,6 +654,7 @@ void ContextManager::trackedObjectsSyncCb(const temoto_core::ConfigSync& msg, co
                         << msg.temoto_namespace << "' anymore.");
 
     // Remove a notion about a object that is being tracked
+    std::lock_guard<std::mutex> lock(tracking_mutex_);
     m_tracked_objects_remote_.erase(payload);
   }
 }
@@ -165,12 +682,38 @@ void ContextManager::advertiseEmr()
 {
   // Publish all items 
   Items items_payload = emr_interface->EmrToVector();
+
+  /*
+   * In owner-partitioned mode advertise only the items maintained by this manager. Items of
+   * other maintainers are relayed only if the maintainer itself has gone silent
+   */
+  if (emr_sync_mode_ == EmrSyncMode::OWNER_PARTITIONED)
+  {
+    const std::string own_namespace = temoto_core::common::getTemotoNamespace();
+    std::lock_guard<std::mutex> lock(emr_peers_mutex_);
+    items_payload.erase(std::remove_if(items_payload.begin(), items_payload.end(),
+                        [&](const ItemContainer& item)
+                        {
+                          return item.maintainer != own_namespace && isEmrPeerReachable(item.maintainer);
+                        }), items_payload.end());
+  }
+
   // If there is something to send, advertise.
   if (items_payload.size()) 
   {
     emr_syncer_.advertise(items_payload);
   }
 }
+bool ContextManager::isEmrPeerReachable(const std::string& temoto_namespace) const
+{
+  const auto peer_it = emr_peers_last_seen_.find(temoto_namespace);
+  if (peer_it == emr_peers_last_seen_.end())
+  {
+    return false;
+  }
+  return (ros::Time::now() - peer_it->second) < emr_peer_timeout_;
+}
+
 template <class Container>
 std::string ContextManager::parseContainerType()
 {
@@ -244,7 +787,19 @@ bool ContextManager::getEmrItem(const std::string& name, std::string type, ItemC
 }
 bool ContextManager::getEmrVectorCb(GetEMRVector::Request& req, GetEMRVector::Response& res)
 {
-  res.items = emr_interface->EmrToVector();
+  bool success = false;
+  res.items = emr_ros_interface_->EmrToVector(req.root
+                                             , req.max_depth
+                                             , req.type
+                                             , req.cursor
+                                             , req.page_size
+                                             , res.next_cursor
+                                             , success);
+  res.success = success;
+  if (!success)
+  {
+    TEMOTO_WARN_STREAM("Could not get the EMR vector, unknown root '" << req.root << "' or cursor '" << req.cursor << "'");
+  }
   return true;
 }
 std::vector<std::string> ContextManager::getItemDetectionMethods(const std::string& name)
@@ -311,35 +866,218 @@ bool ContextManager::updateEmrCb(UpdateEmr::Request& req, UpdateEmr::Response& r
 
 bool ContextManager::getEmrItemCb(GetEMRItem::Request& req, GetEMRItem::Response& res)
 {
-  TEMOTO_INFO_STREAM("Received a request to get item: " << req.name << "from the EMR." << std::endl);
+  TEMOTO_DEBUG_STREAM("Received a request to get item: " << req.name << " from the EMR.");
   ItemContainer nc;
   
   res.success = ContextManager::getEmrItem(req.name, req.type, nc);
   res.item = nc;
-  TEMOTO_WARN_STREAM("t1 " << res.success);
   return true;
 }
 
-/*
- * Server for tracking objects
- */
-void ContextManager::loadTrackObjectCb(TrackObject::Request& req, TrackObject::Response& res)
+bool ContextManager::getEmrItemsCb(GetEMRItems::Request& req, GetEMRItems::Response& res)
 {
-  try
+  TEMOTO_DEBUG_STREAM("Received a request to get " << req.names.size() << " items from the EMR.");
+  if (!req.types.empty() && req.types.size() != req.names.size())
   {
-    TEMOTO_INFO_STREAM("Received a request to track an object named: '" << req.object_name << "'");
+    TEMOTO_ERROR_STREAM("The number of requested types does not match the number of requested names");
+    return false;
+  }
 
-    /*
-     * Check if this object is already tracked in other instance of TeMoto. If thats the case, then
-     * relay the request to the remote TeMoto instance. The response from the remote instance is 
-     * forwarded back to the initial client that initiated the query.
-     * 
-     * M_TODO_lp: Implement a functionality that allows to see what and where 
-     * (in terms of local/remote instances) objects are actively tracked., i.e., uncomment and
-     * modify the following block.
-     */
+  // All items are resolved under a single lock, so they describe the same state of the EMR
+  std::vector<bool> found;
+  res.items = emr_interface->getItems(req.names, found);
+  res.found.resize(found.size());
+  for (size_t i = 0; i < found.size(); i++)
+  {
+    bool type_matches = req.types.empty() || req.types[i].empty() || req.types[i] == res.items[i].type;
+    res.found[i] = found[i] && type_matches;
+  }
+  return true;
+}
 
-    // std::string remote_temoto_namespace = m_tracked_objects_remote_[item_name_no_space];
+bool ContextManager::getEmrItemsInRegionCb(GetEMRItemsInRegion::Request& req, GetEMRItemsInRegion::Response& res)
+{
+  std::vector<emr_ros_interface::SpatialMatch> matches;
+  switch (req.query_type)
+  {
+    case GetEMRItemsInRegion::Request::RADIUS:
+      matches = emr_ros_interface_->radiusSearch(req.frame_id, req.center, req.radius);
+      break;
+    case GetEMRItemsInRegion::Request::BOX:
+      matches = emr_ros_interface_->boxSearch(req.frame_id, req.min_corner, req.max_corner);
+      break;
+    case GetEMRItemsInRegion::Request::NEAREST:
+      matches = emr_ros_interface_->nearestSearch(req.frame_id, req.center, req.k);
+      break;
+    default:
+      TEMOTO_ERROR_STREAM("Unknown spatial query type: " << int(req.query_type));
+      res.success = false;
+      return true;
+  }
+
+  res.names.reserve(matches.size());
+  res.frame_ids.reserve(matches.size());
+  res.positions.reserve(matches.size());
+  res.distances.reserve(matches.size());
+  for (const auto& match : matches)
+  {
+    res.names.push_back(match.name);
+    res.frame_ids.push_back(match.frame_id);
+    res.positions.push_back(match.position);
+    res.distances.push_back(match.distance);
+  }
+  res.success = true;
+  return true;
+}
+
+bool ContextManager::getEmrWorldPosesCb(GetEMRWorldPoses::Request& req, GetEMRWorldPoses::Response& res)
+{
+  TEMOTO_DEBUG_STREAM("Received a request to get the world poses of " << req.names.size() << " EMR items.");
+  std::vector<bool> found;
+  res.poses = emr_interface->getWorldPoses(req.names, found);
+  res.found.assign(found.begin(), found.end());
+  return true;
+}
+
+bool ContextManager::queryEmrCb(QueryEMR::Request& req, QueryEMR::Response& res)
+{
+  TEMOTO_DEBUG_STREAM("Received an EMR query, cursor: '" << req.cursor << "'");
+  emr::AttributeIndex::Attributes constraints;
+  auto add_constraint = [&](const std::string& key, const std::string& value)
+  {
+    if (!value.empty())
+    {
+      constraints.emplace_back(key, value);
+    }
+  };
+  add_constraint(emr_ros_interface::emr_attributes::TYPE, req.type);
+  add_constraint(emr_ros_interface::emr_attributes::MAINTAINER, req.maintainer);
+  add_constraint(emr_ros_interface::emr_attributes::DETECTION_METHOD, req.detection_method);
+  add_constraint(emr_ros_interface::emr_attributes::ODOM_FRAME_ID, req.odom_frame_id);
+  add_constraint(emr_ros_interface::emr_attributes::BASE_FRAME_ID, req.base_frame_id);
+
+  const size_t page_size = req.page_size == 0 ? 100 : req.page_size;
+  res.names = emr_ros_interface_->queryItems(constraints
+                                           , req.subtree_root
+                                           , req.cursor
+                                           , page_size
+                                           , res.next_cursor
+                                           , req.names_only ? nullptr : &res.items);
+  return true;
+}
+
+bool ContextManager::watchEmrCb(WatchEmr::Request& req, WatchEmr::Response& res)
+{
+  res.watch_id = emr_watch_manager_->addWatch(req, res.topic);
+  TEMOTO_DEBUG_STREAM("Created EMR watch " << res.watch_id << " on topic " << res.topic);
+  return true;
+}
+
+bool ContextManager::unwatchEmrCb(UnwatchEmr::Request& req, UnwatchEmr::Response& res)
+{
+  res.success = emr_watch_manager_->removeWatch(req.watch_id);
+  return true;
+}
+
+bool ContextManager::getEmrObjectsByTagCb(GetEMRObjectsByTag::Request& req, GetEMRObjectsByTag::Response& res)
+{
+  std::vector<bool> found;
+  std::vector<TaggedObject> objects = emr_interface->getObjectsByTagIds(req.tag_ids, found);
+
+  res.names.reserve(objects.size());
+  res.poses.reserve(objects.size());
+  res.obj_relative_poses.reserve(objects.size());
+  for (const auto& object : objects)
+  {
+    res.names.push_back(object.name);
+    res.poses.push_back(object.pose);
+    res.obj_relative_poses.push_back(object.obj_relative_pose);
+  }
+  res.found.assign(found.begin(), found.end());
+  return true;
+}
+
+bool ContextManager::getEmrPosesAtCb(GetEMRPosesAt::Request& req, GetEMRPosesAt::Response& res)
+{
+  std::vector<bool> found;
+  res.poses = emr_interface->getPosesAt(req.names, req.stamps, found);
+  res.found.assign(found.begin(), found.end());
+  return true;
+}
+
+void ContextManager::emrChangeCb(uint8_t action, const emr::Item& item, uint64_t version)
+{
+  emr_watch_manager_->onChange(action, item);
+  emr_version_ = version;
+  emr_shm_dirty_ = true;
+
+  EmrInvalidation invalidation;
+  invalidation.name = temoto_core::common::toSnakeCase(item.getName());
+  invalidation.version = version;
+  emr_invalidation_pub_.publish(invalidation);
+}
+
+bool ContextManager::getEmrAtCb(GetEMRAt::Request& req, GetEMRAt::Response& res)
+{
+  bool success = false;
+  EmrHistory::Version version;
+  res.items = emr_ros_interface_->getEmrAt(req.version, req.stamp, req.root, req.max_depth, version, success);
+  res.success = success;
+  if (success)
+  {
+    res.version = version.number;
+    res.stamp = version.stamp;
+  }
+  else
+  {
+    TEMOTO_WARN_STREAM("Could not get the EMR version " << req.version << " at " << req.stamp << " with root '" << req.root << "'");
+  }
+  return true;
+}
+
+bool ContextManager::pinEmrVersionCb(PinEMRVersion::Request& req, PinEMRVersion::Response& res)
+{
+  if (req.pin)
+  {
+    res.version = emr_ros_interface_->pinVersion(req.version);
+    res.success = res.version != 0;
+  }
+  else
+  {
+    res.version = req.version;
+    res.success = emr_ros_interface_->unpinVersion(req.version);
+  }
+  return true;
+}
+
+bool ContextManager::pingCb(PingContextManager::Request& req, PingContextManager::Response& res)
+{
+  return true;
+}
+
+/*
+ * Server for tracking objects
+ */
+void ContextManager::loadTrackObjectCb(TrackObject::Request& req, TrackObject::Response& res)
+{
+  try
+  {
+    TEMOTO_INFO_STREAM("Received a request to track an object named: '" << req.object_name << "'");
+
+    // The trackers are run by the action engine, which might still be starting up
+    waitForActionEngine();
+
+    /*
+     * Check if this object is already tracked in other instance of TeMoto. If thats the case, then
+     * relay the request to the remote TeMoto instance. The response from the remote instance is 
+     * forwarded back to the initial client that initiated the query.
+     * 
+     * M_TODO_lp: Implement a functionality that allows to see what and where 
+     * (in terms of local/remote instances) objects are actively tracked., i.e., uncomment and
+     * modify the following block.
+     */
+
+    // std::string remote_temoto_namespace = m_tracked_objects_remote_[item_name_no_space];
 
     // if (!remote_temoto_namespace.empty())
     // {
@@ -361,144 +1099,679 @@ void ContextManager::loadTrackObjectCb(TrackObject::Request& req, TrackObject::R
     // }
 
     /*
-     * Look if the requested object is described in the object database
-     */ 
-    std::vector<std::string> detection_methods = getItemDetectionMethods(req.object_name);
-
-    /*
-     * Start a pipe that provides the raw data for tracking the requested object
+     * Attach to the tracker of the object, it is started if the object is not tracked yet
      */
-    temoto_component_manager::LoadPipe load_pipe_msg;
-    // addDetectionMethods(detection_methods);
-    std::string selected_pipe;
-    load_pipe_msg.request.use_only_local_segments = req.use_only_local_resources;
+    SharedTracker tracker = acquireTracker(req.object_name, req.use_only_local_resources);
+    res.object_topic = tracker.object_topic;
 
     /*
-     * Loop over different pipe categories and try to load one. The loop is iterated either until
-     * a pipe is succesfully loaded or options are exhausted (failure)
-     */
-    for (auto& pipe_category : detection_methods)
+     * Put the object into the list of tracked objects. This is used later for releasing
+     * the tracker
+     */ 
+    std::lock_guard<std::mutex> lock(tracking_mutex_);
+    active_detection_method_.first = tracker.pipe_resource_id;
+    active_detection_method_.second = tracker.pipe_category;
+    m_tracked_objects_local_[res.trr.resource_id] = TrackerHold{req.object_name, tracker.id};
+  }
+  catch (temoto_core::error::ErrorStack& error_stack)
+  {
+    throw FORWARD_ERROR(error_stack);
+  }
+}
+
+/*
+ * Attach to the tracker of an object
+ */
+SharedTracker ContextManager::acquireTracker(const std::string& object_name, bool use_only_local_resources)
+{
+  // The trackers are keyed by the name of the EMR item, so that differently spelled requests share them
+  const std::string tracker_key = temoto_core::common::toSnakeCase(object_name);
+  std::unique_lock<std::mutex> lock(shared_trackers_mutex_);
+  for (auto tracker_it = shared_trackers_.find(tracker_key);
+       tracker_it != shared_trackers_.end();
+       tracker_it = shared_trackers_.find(tracker_key))
+  {
+    if (!tracker_it->second.starting)
+    {
+      tracker_it->second.holders++;
+      TEMOTO_INFO_STREAM("The " << object_name << " is already tracked, sharing its tracker with "
+                         << tracker_it->second.holders - 1 << " other holders");
+      return tracker_it->second;
+    }
+
+    // Another request is starting the tracker, wait until it has succeeded or failed
+    shared_trackers_cv_.wait(lock);
+  }
+
+  /*
+   * Reserve the tracker, so that the requests that arrive while it is being started wait for it
+   * instead of starting a duplicate. The pipe and the tracker are started without holding the lock
+   */
+  SharedTracker& starting_tracker = shared_trackers_[tracker_key];
+  starting_tracker.starting = true;
+  starting_tracker.id = next_tracker_id_++;
+  SharedTracker tracker = starting_tracker;
+  lock.unlock();
+
+  auto abandon_tracker = [&]
+  {
+    std::lock_guard<std::mutex> abandon_lock(shared_trackers_mutex_);
+    shared_trackers_.erase(tracker_key);
+    shared_trackers_cv_.notify_all();
+  };
+
+  /*
+   * Start a pipe that provides the raw data for tracking the requested object, or share a
+   * pipe that is already running
+   */
+  TrackingPipe pipe;
+  try
+  {
+    tracker.pipe_key = acquireTrackingPipe(object_name, use_only_local_resources, pipe);
+  }
+  catch (temoto_core::error::ErrorStack& error_stack)
+  {
+    abandon_tracker();
+    throw FORWARD_ERROR(error_stack);
+  }
+  tracker.pipe_category = pipe.pipe_category;
+  tracker.pipe_resource_id = pipe.load_pipe_msg.response.trr.resource_id;
+
+  /*
+   * Start the object tracker
+   */
+  try
+  {
+    if (std::find(demux_detection_methods_.begin(), demux_detection_methods_.end(), pipe.pipe_category)
+        != demux_detection_methods_.end())
+    {
+      attachToDemux(object_name, tracker.pipe_key, tracker.object_topic);
+    }
+    else
+    {
+      tracker.umrf_graph_name = startObjectTracker(object_name, pipe, tracker.id, tracker.object_topic);
+    }
+  }
+  catch (temoto_core::error::ErrorStack& error_stack)
+  {
+    releaseTrackingPipe(tracker.pipe_key);
+    abandon_tracker();
+    throw FORWARD_ERROR(error_stack);
+  }
+
+  tracker.holders = 1;
+  tracker.starting = false;
+  lock.lock();
+  shared_trackers_[tracker_key] = tracker;
+  shared_trackers_cv_.notify_all();
+  lock.unlock();
+
+  /*
+   * Let context managers in other namespaces know, that this object is being tracked
+   */ 
+  std::string item_name_no_space = tracker_key;
+  std::replace(item_name_no_space.begin(), item_name_no_space.end(), ' ', '_');
+  tracked_objects_syncer_.advertise(item_name_no_space);
+  return tracker;
+}
+
+/*
+ * Detach from the tracker of an object
+ */
+void ContextManager::releaseTracker(const std::string& object_name, uint64_t tracker_id)
+{
+  std::unique_lock<std::mutex> lock(shared_trackers_mutex_);
+  auto tracker_it = shared_trackers_.find(temoto_core::common::toSnakeCase(object_name));
+  if (tracker_it == shared_trackers_.end() || tracker_it->second.id != tracker_id)
+  {
+    // The tracker was retired after its pipe failed
+    TEMOTO_DEBUG_STREAM("The tracker of the " << object_name << " has already been stopped");
+    return;
+  }
+
+  if (--tracker_it->second.holders > 0)
+  {
+    TEMOTO_DEBUG_STREAM("The tracker of the " << object_name << " still has " << tracker_it->second.holders
+                        << " holders");
+    return;
+  }
+
+  TEMOTO_DEBUG_STREAM("Stopping the tracker of the " << object_name << ", its last holder has left");
+  SharedTracker tracker = tracker_it->second;
+  shared_trackers_.erase(tracker_it);
+  lock.unlock();
+
+  stopTracker(temoto_core::common::toSnakeCase(object_name), tracker);
+  releaseTrackingPipe(tracker.pipe_key);
+}
+
+/*
+ * Stop a tracker that is not shared anymore
+ */
+void ContextManager::stopTracker(const std::string& object_name, const SharedTracker& tracker)
+{
+  if (tracker.umrf_graph_name.empty())
+  {
+    detachFromDemux(object_name, tracker.pipe_key);
+  }
+  else
+  {
+    action_engine_.stopUmrfGraph(tracker.umrf_graph_name);
+  }
+
+  // Let context managers in other namespaces know, that this object is not tracked anymore
+  std::string item_name_no_space = object_name;
+  std::replace(item_name_no_space.begin(), item_name_no_space.end(), ' ', '_');
+  tracked_objects_syncer_.advertise(item_name_no_space, temoto_core::trr::sync_action::REMOVE_CONFIG);
+}
+
+/*
+ * Detach from a tracking pipe
+ */
+void ContextManager::releaseTrackingPipe(const std::string& pipe_key)
+{
+  TrackingPipe pipe;
+  {
+    std::lock_guard<std::mutex> lock(shared_trackers_mutex_);
+    auto holders_it = tracking_pipe_holders_.find(pipe_key);
+    if (holders_it == tracking_pipe_holders_.end())
     {
-      // Check if this type of pipe exists in the registry
-      if (!component_to_emr_registry_.hasPipe(pipe_category))
+      // The pipe has failed and it has been dropped already
+      return;
+    }
+    if (--holders_it->second > 0)
+    {
+      return;
+    }
+    tracking_pipe_holders_.erase(holders_it);
+    pipe = tracking_pipes_.at(pipe_key);
+    tracking_pipes_.erase(pipe_key);
+  }
+
+  TEMOTO_DEBUG_STREAM("Unloading the '" << pipe.load_pipe_msg.request.pipe_name << "' pipe, it does not feed any trackers");
+  try
+  {
+    resource_registrar_2_.unloadClientResource(pipe.load_pipe_msg.response.trr.resource_id);
+  }
+  catch (temoto_core::error::ErrorStack& error_stack)
+  {
+    TEMOTO_ERROR_STREAM("Failed to unload the '" << pipe.load_pipe_msg.request.pipe_name << "' pipe");
+  }
+}
+
+/*
+ * Attach to a pipe for tracking an item
+ */
+std::string ContextManager::acquireTrackingPipe(const std::string& object_name
+                                               , bool use_only_local_resources
+                                               , TrackingPipe& pipe)
+{
+  /*
+   * Look if the requested object is described in the object database
+   */ 
+  std::vector<std::string> detection_methods = getItemDetectionMethods(object_name);
+
+  /*
+   * Resolve the pipes of the detection methods, in their order of preference. Pipes that are
+   * requested with the same parameters provide the same data, hence an already loaded pipe is
+   * shared instead of loading it again
+   */
+  std::vector<std::string> candidate_keys;
+  std::vector<TrackingPipe> candidates;
+  for (const auto& pipe_category : detection_methods)
+  {
+    // Check if this type of pipe exists in the registry
+    if (!component_to_emr_registry_.hasPipe(pipe_category))
+    {
+      TEMOTO_ERROR_STREAM("Could not locate pipe: " << pipe_category);
+      continue;
+    }
+
+    // The pipes of a category are ranked by how fast and how reliably they have been loaded
+    for (const auto& pipe_info_msg : component_to_emr_registry_.getPipesByType(pipe_category))
+    {
+      TrackingPipe candidate;
+      std::string pipe_key;
+      if (!prepareTrackingPipe(pipe_info_msg, pipe_category, object_name, use_only_local_resources, candidate, pipe_key) ||
+          std::find(candidate_keys.begin(), candidate_keys.end(), pipe_key) != candidate_keys.end())
       {
-        TEMOTO_ERROR_STREAM("Could not locate pipe: " << pipe_category);
         continue;
       }
+      candidate_keys.push_back(pipe_key);
+      candidates.push_back(candidate);
+    }
+  }
 
-      try
-      {
-        temoto_component_manager::Pipe pipe_info_msg;
-        if (!component_to_emr_registry_.getPipeByType(pipe_category, pipe_info_msg))
-        {
-          continue;
-        }
+  /*
+   * Try to load the candidates in batches of speculative_pipe_loads_ until a pipe is
+   * succesfully loaded or options are exhausted (failure). The pipes that are being loaded by
+   * other requests are waited for, the pipes are loaded without holding the lock
+   */
+  std::unique_lock<std::mutex> lock(shared_trackers_mutex_);
+  size_t next_candidate = 0;
+  while (next_candidate < candidates.size())
+  {
+    const std::string& next_key = candidate_keys[next_candidate];
+    if (starting_pipes_.count(next_key) != 0)
+    {
+      shared_trackers_cv_.wait(lock);
+      continue;
+    }
+    if (tracking_pipes_.find(next_key) != tracking_pipes_.end())
+    {
+      TEMOTO_DEBUG_STREAM("Sharing the already loaded '" << candidates[next_candidate].pipe_category << "' pipe");
+      tracking_pipe_holders_[next_key]++;
+      pipe = tracking_pipes_.at(next_key);
+      return next_key;
+    }
 
-        TEMOTO_INFO_STREAM("Trying to track the " << req.object_name
-                           << " via '"<< pipe_category << "'");
-        load_pipe_msg = temoto_component_manager::LoadPipe(); // Clear the message
+    std::vector<size_t> batch;
+    std::vector<TrackingPipe> batch_pipes;
+    while (next_candidate < candidates.size() &&
+           batch.size() < static_cast<size_t>(speculative_pipe_loads_) &&
+           starting_pipes_.count(candidate_keys[next_candidate]) == 0 &&
+           tracking_pipes_.find(candidate_keys[next_candidate]) == tracking_pipes_.end())
+    {
+      TEMOTO_INFO_STREAM("Trying to track the " << object_name << " via '"
+                         << candidates[next_candidate].pipe_category << "'");
+      batch.push_back(next_candidate);
+      batch_pipes.push_back(candidates[next_candidate]);
+      starting_pipes_.insert(candidate_keys[next_candidate]);
+      next_candidate++;
+    }
+    lock.unlock();
 
-        /*
-         * Check if any segments of this pipe require knowledge about any geometrical 
-         * parameters ,i.e., frames
-         */
-        if (!getParameterSpecifications(pipe_info_msg, load_pipe_msg, pipe_category, req.object_name))
-        {
-          continue;
-        }
+    auto finish_batch = [&]
+    {
+      for (size_t candidate_index : batch)
+      {
+        starting_pipes_.erase(candidate_keys[candidate_index]);
+      }
+      shared_trackers_cv_.notify_all();
+    };
 
-        load_pipe_msg.request.pipe_category = pipe_category;
-        resource_registrar_1_.call<temoto_component_manager::LoadPipe>(temoto_component_manager::srv_name::MANAGER_2,
-                                                                     temoto_component_manager::srv_name::PIPE_SERVER,
-                                                                     load_pipe_msg);
+    try
+    {
+      size_t loaded = loadFirstPipe(batch_pipes);
+      lock.lock();
+      tracking_pipes_.emplace(candidate_keys[batch[loaded]], batch_pipes[loaded]);
+      tracking_pipe_holders_[candidate_keys[batch[loaded]]] = 1;
+      finish_batch();
+      pipe = batch_pipes[loaded];
+      return candidate_keys[batch[loaded]];
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      lock.lock();
+      finish_batch();
 
-        selected_pipe = pipe_category;
-        // detection_method_history_[pipe_category].adjustReliability();
-        active_detection_method_.first = load_pipe_msg.response.trr.resource_id;
-        active_detection_method_.second = pipe_category;
-        break;
+      // If the requested pipes were not found but there are other options
+      // available, then continue. Otherwise forward the error
+      if (error_stack.front().code == static_cast<int>(temoto_core::error::Code::NO_TRACKERS_FOUND) &&
+          next_candidate < candidates.size())
+      {
+        continue;
       }
-      catch (temoto_core::error::ErrorStack& error_stack)
+      else
+      {
+        throw FORWARD_ERROR(error_stack);
+      }
+    }
+  }
+
+  throw CREATE_ERROR(temoto_core::error::Code::NO_TRACKERS_FOUND, "Could not load a pipe for tracking the "
+                     + object_name);
+}
+
+/*
+ * Resolve the parameters of a pipe
+ */
+bool ContextManager::prepareTrackingPipe(const temoto_component_manager::Pipe& pipe_info_msg
+                                        , const std::string& pipe_category
+                                        , const std::string& object_name
+                                        , bool use_only_local_resources
+                                        , TrackingPipe& pipe
+                                        , std::string& pipe_key)
+{
+  pipe.pipe_category = pipe_category;
+  pipe.load_pipe_msg = temoto_component_manager::LoadPipe();
+  pipe.load_pipe_msg.request.use_only_local_segments = use_only_local_resources;
+
+  /*
+   * Check if any segments of this pipe require knowledge about any geometrical 
+   * parameters ,i.e., frames
+   */
+  if (!getParameterSpecifications(pipe_info_msg, pipe.load_pipe_msg, pipe_category, object_name))
+  {
+    return false;
+  }
+  pipe.load_pipe_msg.request.pipe_category = pipe_category;
+  pipe.load_pipe_msg.request.pipe_name = pipe_info_msg.pipe_name;
+
+  const auto serialized_request = temoto_core::serializeROSmsg(pipe.load_pipe_msg.request);
+  pipe_key = std::string(serialized_request.begin(), serialized_request.end());
+  return true;
+}
+
+/*
+ * Load the first pipe that succeeds
+ */
+size_t ContextManager::loadFirstPipe(std::vector<TrackingPipe>& pipes)
+{
+  if (pipes.size() == 1)
+  {
+    loadPipe(pipes.front());
+    return 0;
+  }
+
+  struct PipeLoadRace
+  {
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::vector<TrackingPipe> pipes;
+    size_t pending;
+    int winner;
+    std::map<size_t, temoto_core::error::ErrorStack> errors;
+  };
+  auto race = std::make_shared<PipeLoadRace>();
+  race->pipes = pipes;
+  race->pending = pipes.size();
+  race->winner = -1;
+
+  {
+    std::lock_guard<std::mutex> lock(pipe_loads_mutex_);
+    pipe_loads_.remove_if([](const std::future<void>& pipe_load)
+    {
+      return pipe_load.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+
+    for (size_t i = 0; i < pipes.size(); i++)
+    {
+      pipe_loads_.push_back(std::async(std::launch::async, [this, race, i]
       {
-        // detection_method_history_[pipe_category].adjustReliability(0);
+        TrackingPipe& pipe = race->pipes[i];
+        try
+        {
+          loadPipe(pipe);
+        }
+        catch (temoto_core::error::ErrorStack& error_stack)
+        {
+          std::lock_guard<std::mutex> lock(race->mutex);
+          race->errors.emplace(i, error_stack);
+          race->pending--;
+          race->finished.notify_all();
+          return;
+        }
 
-        // If the requested pipe was not found but there are other options
-        // available, then continue. Otherwise forward the error
-        if (error_stack.front().code == static_cast<int>(temoto_core::error::Code::NO_TRACKERS_FOUND) &&
-            &pipe_category != &detection_methods.back())
+        std::unique_lock<std::mutex> lock(race->mutex);
+        race->pending--;
+        if (race->winner < 0)
         {
-          continue;
+          race->winner = static_cast<int>(i);
+          race->finished.notify_all();
+          return;
         }
-        else
+        lock.unlock();
+
+        // A pending service call can not be cancelled, hence the pipes that were loaded too late
+        // are unloaded as soon as they arrive
+        TEMOTO_DEBUG_STREAM("Unloading the '" << pipe.pipe_category << "' pipe, another pipe was loaded first");
+        try
         {
-          throw FORWARD_ERROR(error_stack);
+          resource_registrar_2_.unloadClientResource(pipe.load_pipe_msg.response.trr.resource_id);
         }
-      }
+        catch (temoto_core::error::ErrorStack& error_stack)
+        {
+          TEMOTO_ERROR_STREAM("Failed to unload the '" << pipe.pipe_category << "' pipe");
+        }
+      }));
     }
+  }
 
-    /*
-     * Start the object tracker. Since there are different general object
-     * tracking methods and each tracker outputs different types of data, then
-     * the specific tracking has to be set up based on the general tracker. For example
-     * a general tracker, e.g. AR tag detector, publshes data about detected tags. The
-     * specific tracker has to subscribe to the detected tags topic and since the
-     * tags are differentiated by the tag ID, the specific tracker has to know the ID
-     * beforehand.
-     */
+  std::unique_lock<std::mutex> lock(race->mutex);
+  race->finished.wait(lock, [&race]{return race->winner >= 0 || race->pending == 0;});
+  if (race->winner >= 0)
+  {
+    pipes[race->winner] = race->pipes[race->winner];
+    return race->winner;
+  }
 
-    /*
-     * Get the topic where the tracker publishes its output data
-     */
-    temoto_core::TopicContainer pipe_topics;
-    pipe_topics.setOutputTopicsByKeyValue(load_pipe_msg.response.output_topics);
+  // Prefer the errors that are not about a missing tracker, since these stop the search
+  for (auto& error : race->errors)
+  {
+    if (error.second.front().code != static_cast<int>(temoto_core::error::Code::NO_TRACKERS_FOUND))
+    {
+      throw FORWARD_ERROR(error.second);
+    }
+  }
+  throw FORWARD_ERROR(race->errors.rbegin()->second);
+}
 
-    // Topic where the information about the required object is going to be published.
-    std::string item_name_no_space = req.object_name;
-    std::replace(item_name_no_space.begin(), item_name_no_space.end(), ' ', '_');
-    std::string tracked_object_topic = temoto_core::common::getAbsolutePath("object_tracker/" + item_name_no_space);
+/*
+ * Load a pipe and record how it went
+ */
+void ContextManager::loadPipe(TrackingPipe& pipe)
+{
+  const ros::WallTime start_time = ros::WallTime::now();
+  try
+  {
+    resource_registrar_2_.call<temoto_component_manager::LoadPipe>(temoto_component_manager::srv_name::MANAGER_2,
+                                                                 temoto_component_manager::srv_name::PIPE_SERVER,
+                                                                 pipe.load_pipe_msg);
+  }
+  catch (temoto_core::error::ErrorStack& error_stack)
+  {
+    recordPipeLoad(pipe, false, (ros::WallTime::now() - start_time).toSec());
+    throw FORWARD_ERROR(error_stack);
+  }
+  recordPipeLoad(pipe, true, (ros::WallTime::now() - start_time).toSec());
+}
 
-    /*
-     * Object tracker setup
-     */
-    TEMOTO_DEBUG_STREAM("Using " << selected_pipe << " based tracking");
+void ContextManager::recordPipeLoad(const TrackingPipe& pipe, bool success, double latency)
+{
+  TEMOTO_DEBUG_STREAM((success ? "Loaded" : "Failed to load") << " the '" << pipe.load_pipe_msg.request.pipe_name
+                      << "' pipe in " << latency << " s");
+
+  // The statistics are saved in the background, see pipeStatisticsTimerCallback()
+  component_to_emr_registry_.recordPipeLoad(pipe.load_pipe_msg.request.pipe_name, success, latency);
+  pipe_statistics_dirty_ = true;
+}
 
+/*
+ * Start a tracker for an item
+ */
+std::string ContextManager::startObjectTracker(const std::string& object_name
+                                              , const TrackingPipe& pipe
+                                              , uint64_t tracker_id
+                                              , std::string& object_topic)
+{
+  /*
+   * Start the object tracker. Since there are different general object
+   * tracking methods and each tracker outputs different types of data, then
+   * the specific tracking has to be set up based on the general tracker. For example
+   * a general tracker, e.g. AR tag detector, publshes data about detected tags. The
+   * specific tracker has to subscribe to the detected tags topic and since the
+   * tags are differentiated by the tag ID, the specific tracker has to know the ID
+   * beforehand.
+   */
+
+  // Topic where the information about the required object is going to be published.
+  std::string item_name_no_space = object_name;
+  std::replace(item_name_no_space.begin(), item_name_no_space.end(), ' ', '_');
+  object_topic = temoto_core::common::getAbsolutePath("object_tracker/" + item_name_no_space);
+
+  /*
+   * Object tracker setup
+   */
+  TEMOTO_DEBUG_STREAM("Using " << pipe.pipe_category << " based tracking");
+  // The graph of a retired tracker may still be stopping, hence the graph is named after the tracker
+  std::string umrf_graph_name = item_name_no_space + "_" + std::to_string(tracker_id) + "_graph";
+  startTrackerAction(object_name, pipe, object_topic, umrf_graph_name);
+  return umrf_graph_name;
+}
+
+/*
+ * Start a tracker action
+ */
+void ContextManager::startTrackerAction(const std::string& object_name
+                                       , const TrackingPipe& pipe
+                                       , const std::string& output_topic
+                                       , const std::string& umrf_graph_name)
+{
+  /*
+   * Get the topic where the tracker publishes its output data
+   */
+  temoto_core::TopicContainer pipe_topics;
+  pipe_topics.setOutputTopicsByKeyValue(pipe.load_pipe_msg.response.output_topics);
+
+  /*
+   * Action related stuff up ahead: An UMRF is manually created, that corresponds an Action.
+   * The tracker action is invoked  and it continues to run in the background until its ordered to stop.
+   */
+
+  Umrf track_object_umrf;
+  track_object_umrf.setName("TaTrackCmObject");
+  track_object_umrf.setSuffix("0");
+  track_object_umrf.setEffect("synchronous");
+
+  ActionParameters ap;
+  ap.setParameter("tracked_object::name", "string", boost::any_cast<std::string>(object_name));
+  ap.setParameter("tracked_object::output_topic", "string", boost::any_cast<std::string>(output_topic));
+  ap.setParameter("pipe::name", "string", boost::any_cast<std::string>(pipe.pipe_category));
+  ap.setParameter("pipe::topic", "temoto_core::TopicContainer", boost::any_cast<temoto_core::TopicContainer>(pipe_topics));
+  ap.setParameter("emr", "std::shared_ptr<EnvModelInterface>", boost::any_cast<std::shared_ptr<EnvModelInterface>>(emr_interface));
+
+  track_object_umrf.setInputParameters(ap);
+  action_engine_.executeUmrfGraph(umrf_graph_name, std::vector<Umrf>{track_object_umrf}, true);
+}
+
+/*
+ * Route the detections of a shared tracker to an object
+ */
+void ContextManager::attachToDemux(const std::string& object_name
+                                  , const std::string& pipe_key
+                                  , std::string& object_topic)
+{
+  std::string item_name_no_space = object_name;
+  std::replace(item_name_no_space.begin(), item_name_no_space.end(), ' ', '_');
+  object_topic = temoto_core::common::getAbsolutePath("object_tracker/" + item_name_no_space);
+
+  std::unique_lock<std::mutex> lock(shared_trackers_mutex_);
+  auto demux_it = tracking_demuxes_.find(pipe_key);
+  while (demux_it != tracking_demuxes_.end() && demux_it->second.starting)
+  {
+    // Another object is starting the shared tracker, wait until it has succeeded or failed
+    shared_trackers_cv_.wait(lock);
+    demux_it = tracking_demuxes_.find(pipe_key);
+  }
+
+  if (demux_it == tracking_demuxes_.end())
+  {
     /*
-     * Action related stuff up ahead: An UMRF is manually created, that corresponds an Action.
-     * The tracker action is invoked  and it continues to run in the background until its ordered to stop.
+     * Start the tracker that publishes all detections of the pipe. It is named after the pipe
+     * resource, since several pipes of a category may run at once
      */
+    auto pipe_it = tracking_pipes_.find(pipe_key);
+    if (pipe_it == tracking_pipes_.end())
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::NO_TRACKERS_FOUND, "The pipe of the shared tracker has failed");
+    }
+    const TrackingPipe pipe = pipe_it->second;
+    const std::string demux_name = pipe.pipe_category + "_" + std::to_string(pipe.load_pipe_msg.response.trr.resource_id);
+    TEMOTO_DEBUG_STREAM("Starting a shared " << pipe.pipe_category << " based tracker");
+
+    TrackingDemux tracking_demux;
+    tracking_demux.demux = std::make_shared<TrackedObjectDemux>(nh_
+      , emr_interface
+      , temoto_core::common::getAbsolutePath("object_tracker/demux/" + demux_name));
+    tracking_demux.umrf_graph_name = "demux_" + demux_name + "_graph";
+    tracking_demux.starting = true;
+    tracking_demuxes_[pipe_key] = tracking_demux;
+    lock.unlock();
+
+    try
+    {
+      startTrackerAction("", pipe, tracking_demux.demux->getDetectionsTopic(), tracking_demux.umrf_graph_name);
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      lock.lock();
+      tracking_demuxes_.erase(pipe_key);
+      shared_trackers_cv_.notify_all();
+      throw FORWARD_ERROR(error_stack);
+    }
 
-    Umrf track_object_umrf;
-    track_object_umrf.setName("TaTrackCmObject");
-    track_object_umrf.setSuffix("0");
-    track_object_umrf.setEffect("synchronous");
+    lock.lock();
+    demux_it = tracking_demuxes_.find(pipe_key);
+    demux_it->second.starting = false;
+    shared_trackers_cv_.notify_all();
+  }
+  demux_it->second.demux->addObject(object_name, object_topic);
+}
 
-    ActionParameters ap;
-    ap.setParameter("tracked_object::name", "string", boost::any_cast<std::string>(req.object_name));
-    ap.setParameter("tracked_object::output_topic", "string", boost::any_cast<std::string>(tracked_object_topic));
-    ap.setParameter("pipe::name", "string", boost::any_cast<std::string>(selected_pipe));
-    ap.setParameter("pipe::topic", "temoto_core::TopicContainer", boost::any_cast<temoto_core::TopicContainer>(pipe_topics));
-    ap.setParameter("emr", "std::shared_ptr<EnvModelInterface>", boost::any_cast<std::shared_ptr<EnvModelInterface>>(emr_interface));
+/*
+ * Stop routing the detections of a shared tracker to an object
+ */
+void ContextManager::detachFromDemux(const std::string& object_name, const std::string& pipe_key)
+{
+  std::unique_lock<std::mutex> lock(shared_trackers_mutex_);
+  auto demux_it = tracking_demuxes_.find(pipe_key);
+  if (demux_it == tracking_demuxes_.end() || demux_it->second.demux->removeObject(object_name) > 0)
+  {
+    return;
+  }
 
-    track_object_umrf.setInputParameters(ap);
-    std::string umrf_graph_name = item_name_no_space + "_graph";
-    action_engine_.executeUmrfGraph(umrf_graph_name, std::vector<Umrf>{track_object_umrf}, true);
+  TEMOTO_DEBUG_STREAM("Stopping the shared tracker " << demux_it->second.umrf_graph_name
+                      << ", it does not track any objects");
+  const std::string umrf_graph_name = demux_it->second.umrf_graph_name;
+  tracking_demuxes_.erase(demux_it);
+  lock.unlock();
 
-    /*
-     * Put the umrf graph name into the list of tracked objects. This is used later
-     * for stopping the tracker action
-     */ 
-    m_tracked_objects_local_[res.trr.resource_id] = umrf_graph_name;
-    res.object_topic = tracked_object_topic;
+  action_engine_.stopUmrfGraph(umrf_graph_name);
+}
 
+/*
+ * Server for tracking a group of objects
+ */
+void ContextManager::loadTrackObjectsCb(TrackObjects::Request& req, TrackObjects::Response& res)
+{
+  TEMOTO_INFO_STREAM("Received a request to track " << req.object_names.size() << " objects");
+
+  // The trackers are run by the action engine, which might still be starting up
+  waitForActionEngine();
+
+  std::map<std::string, SharedTracker> trackers;
+  try
+  {
     /*
-     * Let context managers in other namespaces know, that this object is being tracked
-     */ 
-    tracked_objects_syncer_.advertise(item_name_no_space);
+     * Attach to the tracker of each object. Objects that are detected with the same pipe share
+     * a single instance of it, and repeated names share the tracker
+     */
+    for (const auto& object_name : req.object_names)
+    {
+      if (trackers.find(object_name) == trackers.end())
+      {
+        trackers[object_name] = acquireTracker(object_name, req.use_only_local_resources);
+      }
+      res.object_topics.push_back(trackers[object_name].object_topic);
+      res.detection_methods.push_back(trackers[object_name].pipe_category);
+    }
   }
   catch (temoto_core::error::ErrorStack& error_stack)
   {
+    // Do not keep the trackers of the other objects running
+    for (const auto& tracker : trackers)
+    {
+      releaseTracker(tracker.first, tracker.second.id);
+    }
     throw FORWARD_ERROR(error_stack);
   }
+
+  std::lock_guard<std::mutex> lock(tracking_mutex_);
+  for (const auto& tracker : trackers)
+  {
+    m_tracked_object_groups_local_[res.trr.resource_id].push_back(TrackerHold{tracker.first, tracker.second.id});
+  }
 }
 
 /*
@@ -543,6 +1816,8 @@ void ContextManager::unloadTrackObjectCb(TrackObject::Request& req,
    */
   try
   {
+    std::unique_lock<std::mutex> lock(tracking_mutex_);
+
     // Check if the object is tracked locally or by a remote manager
     if (!m_tracked_objects_remote_[req.object_name].empty())
     {
@@ -551,25 +1826,21 @@ void ContextManager::unloadTrackObjectCb(TrackObject::Request& req,
     }
 
     // Get the name of the tracked object
-    std::string tracked_object = m_tracked_objects_local_[res.trr.resource_id];
-
-    if (tracked_object.empty())
+    auto tracked_object_it = m_tracked_objects_local_.find(res.trr.resource_id);
+    if (tracked_object_it == m_tracked_objects_local_.end())
     {
       throw CREATE_ERROR(temoto_core::error::Code::NO_TRACKERS_FOUND, std::string("The object '") +
                          req.object_name + "' is not tracked");
     }
+    TrackerHold tracker_hold = tracked_object_it->second;
+    m_tracked_objects_local_.erase(tracked_object_it);
+    lock.unlock();
 
     TEMOTO_DEBUG_STREAM("Received a request to stop tracking an object named: '"
-                        << tracked_object << "'");
-
-    // Stop tracking the object
-    action_engine_.stopUmrfGraph(tracked_object);
+                        << tracker_hold.object_name << "'");
 
-    // Erase the object from the map of tracked objects
-    m_tracked_objects_local_.erase(res.trr.resource_id);
-
-    // Let context managers in other namespaces know, that this object is not tracked anymore
-    tracked_objects_syncer_.advertise(tracked_object, temoto_core::trr::sync_action::REMOVE_CONFIG);
+    // Stop tracking the object, unless other requests still hold its tracker
+    releaseTracker(tracker_hold.object_name, tracker_hold.tracker_id);
   }
   catch (temoto_core::error::ErrorStack& error_stack)
   {
@@ -577,6 +1848,35 @@ void ContextManager::unloadTrackObjectCb(TrackObject::Request& req,
   }
 }
 
+/*
+ * Unload the group of tracked objects
+ */
+void ContextManager::unloadTrackObjectsCb(TrackObjects::Request& req,
+                                          TrackObjects::Response& res)
+{
+  /*
+   * Release the trackers of the group
+   */
+  std::vector<TrackerHold> tracker_holds;
+  {
+    std::lock_guard<std::mutex> lock(tracking_mutex_);
+    auto group_it = m_tracked_object_groups_local_.find(res.trr.resource_id);
+    if (group_it == m_tracked_object_groups_local_.end())
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::NO_TRACKERS_FOUND, "The group of "
+                         + std::to_string(req.object_names.size()) + " objects is not tracked");
+    }
+    tracker_holds = group_it->second;
+    m_tracked_object_groups_local_.erase(group_it);
+  }
+
+  for (const auto& tracker_hold : tracker_holds)
+  {
+    TEMOTO_DEBUG_STREAM("Received a request to stop tracking an object named: '" << tracker_hold.object_name << "'");
+    releaseTracker(tracker_hold.object_name, tracker_hold.tracker_id);
+  }
+}
+
 
 /*
  * Status callback 1
@@ -592,8 +1892,131 @@ void ContextManager::statusCb1(temoto_core::ResourceStatus& srv)
  */
 void ContextManager::statusCb2(temoto_core::ResourceStatus& srv)
 {
-  (void)srv; // Suppress the "unused parameter" warning
   TEMOTO_DEBUG("Received a status message.");
+  if (srv.request.status_code != temoto_core::trr::status_codes::FAILED)
+  {
+    return;
+  }
+
+  /*
+   * Retire the pipe and the trackers that it feeds. New requests for the objects start new
+   * trackers, the holds on the retired ones are ignored when they are released
+   */
+  std::map<std::string, SharedTracker> failed_trackers;
+  std::string failed_demux_graph;
+  int failed_pipe_resource_id = 0;
+  {
+    std::lock_guard<std::mutex> lock(shared_trackers_mutex_);
+    auto pipe_it = std::find_if(tracking_pipes_.begin(), tracking_pipes_.end(),
+                                [&](const std::pair<const std::string, TrackingPipe>& pipe)
+                                {
+                                  return pipe.second.load_pipe_msg.response.trr.resource_id == srv.request.resource_id;
+                                });
+    if (pipe_it == tracking_pipes_.end())
+    {
+      return;
+    }
+    const std::string pipe_key = pipe_it->first;
+    failed_pipe_resource_id = pipe_it->second.load_pipe_msg.response.trr.resource_id;
+    TEMOTO_WARN_STREAM("The '" << pipe_it->second.load_pipe_msg.request.pipe_name
+                       << "' pipe has failed, retiring the trackers that it feeds");
+
+    for (auto tracker_it = shared_trackers_.begin(); tracker_it != shared_trackers_.end();)
+    {
+      if (!tracker_it->second.starting && tracker_it->second.pipe_key == pipe_key)
+      {
+        failed_trackers.insert(*tracker_it);
+        tracker_it = shared_trackers_.erase(tracker_it);
+      }
+      else
+      {
+        tracker_it++;
+      }
+    }
+
+    auto demux_it = tracking_demuxes_.find(pipe_key);
+    if (demux_it != tracking_demuxes_.end() && !demux_it->second.starting)
+    {
+      failed_demux_graph = demux_it->second.umrf_graph_name;
+      tracking_demuxes_.erase(demux_it);
+    }
+    tracking_pipes_.erase(pipe_it);
+    tracking_pipe_holders_.erase(pipe_key);
+  }
+
+  /*
+   * Stop the retired trackers and release the failed pipe
+   */
+  for (const auto& tracker : failed_trackers)
+  {
+    if (!tracker.second.umrf_graph_name.empty())
+    {
+      stopTracker(tracker.first, tracker.second);
+    }
+    else
+    {
+      std::string item_name_no_space = tracker.first;
+      std::replace(item_name_no_space.begin(), item_name_no_space.end(), ' ', '_');
+      tracked_objects_syncer_.advertise(item_name_no_space, temoto_core::trr::sync_action::REMOVE_CONFIG);
+    }
+  }
+  try
+  {
+    if (!failed_demux_graph.empty())
+    {
+      action_engine_.stopUmrfGraph(failed_demux_graph);
+    }
+    resource_registrar_2_.unloadClientResource(failed_pipe_resource_id);
+  }
+  catch (temoto_core::error::ErrorStack& error_stack)
+  {
+    TEMOTO_ERROR_STREAM("Failed to release the failed pipe");
+  }
+
+  /*
+   * Forward the failure to every request that holds a retired tracker, so that its client
+   * can track the object again
+   */
+  auto is_retired = [&](const TrackerHold& hold)
+  {
+    auto tracker_it = failed_trackers.find(temoto_core::common::toSnakeCase(hold.object_name));
+    return tracker_it != failed_trackers.end() && tracker_it->second.id == hold.tracker_id;
+  };
+
+  std::vector<int> failed_requests;
+  {
+    std::lock_guard<std::mutex> lock(tracking_mutex_);
+    for (const auto& tracked_object : m_tracked_objects_local_)
+    {
+      if (is_retired(tracked_object.second))
+      {
+        failed_requests.push_back(tracked_object.first);
+      }
+    }
+    for (const auto& group : m_tracked_object_groups_local_)
+    {
+      if (std::any_of(group.second.begin(), group.second.end(), is_retired))
+      {
+        failed_requests.push_back(group.first);
+      }
+    }
+  }
+
+  for (int request_id : failed_requests)
+  {
+    temoto_core::ResourceStatus status;
+    status.request.resource_id = request_id;
+    status.request.status_code = temoto_core::trr::status_codes::FAILED;
+    status.request.message = "The pipe of the tracker has failed";
+    try
+    {
+      resource_registrar_1_.sendStatus(status);
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      TEMOTO_ERROR_STREAM("Failed to forward the pipe failure to request " << request_id);
+    }
+  }
 }
 
 void ContextManager::addDetectionMethod(std::string detection_method)
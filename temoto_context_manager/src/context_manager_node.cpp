@@ -32,7 +32,11 @@ int main(int argc, char **argv)
 
     ros::Rate loop_rate(10);
 
-    ros::spin();
+    // The default queue serves the object tracking requests and the resource registrar traffic
+    int tracking_threads;
+    ros::param::param<int>("~tracking_threads", tracking_threads, 2);
+    ros::MultiThreadedSpinner spinner(tracking_threads);
+    spinner.spin();
 
     return 0;
 }
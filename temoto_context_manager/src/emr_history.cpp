@@ -0,0 +1,159 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "temoto_context_manager/emr_history.h"
+
+#include <algorithm>
+
+namespace temoto_context_manager
+{
+
+EmrHistory::EmrHistory(const ros::Duration& retention, size_t max_versions)
+: retention_(retention)
+, max_versions_(std::max<size_t>(max_versions, 1))
+, next_number_(1)
+{}
+
+uint64_t EmrHistory::put(const std::string& name, const Entry& entry, const ros::Time& stamp)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  State state = versions_.empty() ? State() : versions_.back().state;
+  return commit(state.insert(name, std::make_shared<const Entry>(entry)), stamp);
+}
+
+uint64_t EmrHistory::erase(const std::string& name, const ros::Time& stamp)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  State state = versions_.empty() ? State() : versions_.back().state;
+  return commit(state.erase(name), stamp);
+}
+
+uint64_t EmrHistory::commit(State state, const ros::Time& stamp)
+{
+  versions_.push_back(Version{next_number_++, stamp, std::move(state)});
+
+  // A version is needed until the one that replaced it is older than the retention
+  while (versions_.size() > 1 &&
+         (versions_.size() > max_versions_ || versions_[1].stamp + retention_ < stamp))
+  {
+    auto pinned_it = pinned_.find(versions_.front().number);
+    if (pinned_it != pinned_.end())
+    {
+      pinned_it->second.replaced = versions_[1].stamp;
+    }
+    versions_.pop_front();
+  }
+  return versions_.back().number;
+}
+
+bool EmrHistory::getVersion(uint64_t number, Version& version) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return getVersionUnsafe(number, version);
+}
+
+bool EmrHistory::getVersionUnsafe(uint64_t number, Version& version) const
+{
+  if (versions_.empty())
+  {
+    return false;
+  }
+  if (number == 0)
+  {
+    version = versions_.back();
+    return true;
+  }
+
+  // The version numbers in versions_ are consecutive
+  if (number >= versions_.front().number && number <= versions_.back().number)
+  {
+    version = versions_[number - versions_.front().number];
+    return true;
+  }
+  auto pinned_it = pinned_.find(number);
+  if (pinned_it != pinned_.end())
+  {
+    version = pinned_it->second.version;
+    return true;
+  }
+  return false;
+}
+
+bool EmrHistory::getVersionAt(const ros::Time& stamp, Version& version) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // The last version that was made at or before the stamp
+  auto version_it = std::upper_bound(versions_.begin(), versions_.end(), stamp,
+    [](const ros::Time& stamp, const Version& version)
+    {
+      return stamp < version.stamp;
+    });
+  if (version_it != versions_.begin())
+  {
+    version = *(version_it - 1);
+    return true;
+  }
+
+  // Older times are only covered by the pinned versions that were current at the time
+  for (const auto& pinned : pinned_)
+  {
+    const Pin& pin = pinned.second;
+    if (!pin.replaced.isZero() && pin.version.stamp <= stamp && stamp < pin.replaced)
+    {
+      version = pin.version;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t EmrHistory::pin(uint64_t number)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  Version version;
+  if (!getVersionUnsafe(number, version))
+  {
+    return 0;
+  }
+  auto pinned_it = pinned_.find(version.number);
+  if (pinned_it == pinned_.end())
+  {
+    pinned_.emplace(version.number, Pin{version, 1, ros::Time()});
+  }
+  else
+  {
+    pinned_it->second.count++;
+  }
+  return version.number;
+}
+
+bool EmrHistory::unpin(uint64_t number)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto pinned_it = pinned_.find(number);
+  if (pinned_it == pinned_.end())
+  {
+    return false;
+  }
+  if (--pinned_it->second.count == 0)
+  {
+    pinned_.erase(pinned_it);
+  }
+  return true;
+}
+
+} // temoto_context_manager namespace
@@ -116,16 +116,59 @@ bool ComponentToEmrRegistry::hasPipe(std::string pipe_type) const
 }
 
 bool ComponentToEmrRegistry::getPipeByType(std::string pipe_type, temoto_component_manager::Pipe& ret_pipe)
+{
+  std::vector<temoto_component_manager::Pipe> pipes = getPipesByType(pipe_type);
+  if (pipes.empty())
+  {
+    return false;
+  }
+  ret_pipe = pipes.front();
+  return true;
+}
+
+std::vector<temoto_component_manager::Pipe> ComponentToEmrRegistry::getPipesByType(std::string pipe_type) const
 {
   std::lock_guard<std::mutex> guard(pipe_rw_mutex_); // Lock the mutex
-  if (categorized_pipe_infos_.find(pipe_type) != categorized_pipe_infos_.end())
+  std::vector<temoto_component_manager::Pipe> ranked_pipes;
+  auto pipes_it = categorized_pipe_infos_.find(pipe_type);
+  if (pipes_it == categorized_pipe_infos_.end())
   {
-    // TODO: Currently the first pipe in the vector is returned. Should be returned based on
-    // reliability value
-    ret_pipe = categorized_pipe_infos_[pipe_type][0];
-    return true;
+    return ranked_pipes;
   }
-  return false;
+
+  std::vector<std::string> pipe_names;
+  for (const auto& pipe : pipes_it->second)
+  {
+    pipe_names.push_back(pipe.pipe_name);
+  }
+  for (size_t pipe_index : pipe_statistics_.rank(pipe_names))
+  {
+    ranked_pipes.push_back(pipes_it->second[pipe_index]);
+  }
+  return ranked_pipes;
+}
+
+void ComponentToEmrRegistry::recordPipeLoad(const std::string& pipe_name, bool success, double latency)
+{
+  std::lock_guard<std::mutex> guard(pipe_rw_mutex_); // Lock the mutex
+  pipe_statistics_.record(pipe_name, success, latency);
+}
+
+bool ComponentToEmrRegistry::loadPipeStatistics(const std::string& path)
+{
+  std::lock_guard<std::mutex> guard(pipe_rw_mutex_); // Lock the mutex
+  return pipe_statistics_.load(path);
+}
+
+bool ComponentToEmrRegistry::savePipeStatistics(const std::string& path) const
+{
+  // The file is written from a copy, so that the pipes can be ranked meanwhile
+  PipeStatistics pipe_statistics;
+  {
+    std::lock_guard<std::mutex> guard(pipe_rw_mutex_); // Lock the mutex
+    pipe_statistics = pipe_statistics_;
+  }
+  return pipe_statistics.save(path);
 }
 
 bool ComponentToEmrRegistry::setPipes(CategorizedPipes cat_pipes)
@@ -18,6 +18,7 @@
 
 #include "temoto_context_manager/emr_ros_interface.h"
 #include <boost/algorithm/string.hpp>
+#include <cmath>
 
 namespace emr_ros_interface
 {
@@ -107,12 +108,15 @@ bool EmrRosInterface::hasItem(const std::string& name)
 }
 void EmrRosInterface::emrTfCallback(const ros::TimerEvent&)
 {
-  std::lock_guard<std::mutex> lock(emr_iface_mutex);
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
   for (auto const& item_entry : env_model_repository_.getItems())
   {
     // If root node, tf can not be published
     if (item_entry.second->getParent().expired()) continue;
 
+    // The pose of a stale item is not fresh anymore
+    if (stale_items_.count(item_entry.first)) continue;
+
     std::string type = item_entry.second->getPayload()->getType();
     if (type == emr_containers::OBJECT)
     {
@@ -145,45 +149,66 @@ std::vector<temoto_context_manager::ItemContainer> EmrRosInterface::updateEmr(
                   const std::vector<temoto_context_manager::ItemContainer>& items_to_add, 
                   bool update_time)
 {
-  std::lock_guard<std::mutex> lock(emr_iface_mutex);
+  std::lock_guard<std::shared_timed_mutex> lock(emr_iface_mutex);
   
   // Keep track of failed add/update attempts
   std::vector<temoto_context_manager::ItemContainer> failed_items;
   for (const auto& item_container : items_to_add)
   {
+    bool added = false;
+    bool changed = false;
+    std::string item_name;
     if (item_container.type == emr_containers::OBJECT) 
     {
       // Deserialize into an temoto_context_manager::ObjectContainer object and add to EMR
       temoto_context_manager::ObjectContainer oc = 
         temoto_core::deserializeROSmsg<temoto_context_manager::ObjectContainer>(item_container.serialized_container);
-      if (!addOrUpdateEmrItem(oc, emr_containers::OBJECT, item_container.maintainer, update_time)) failed_items.push_back(item_container);
+      item_name = oc.name;
+      added = addOrUpdateEmrItem(oc, emr_containers::OBJECT, item_container.maintainer, update_time, changed);
     }
     else if (item_container.type == emr_containers::MAP) 
     {
       // Deserialize into an temoto_context_manager::MapContainer object and add to EMR
       temoto_context_manager::MapContainer mc = 
         temoto_core::deserializeROSmsg<temoto_context_manager::MapContainer>(item_container.serialized_container);
-      if (!addOrUpdateEmrItem(mc, emr_containers::MAP, item_container.maintainer, update_time)) failed_items.push_back(item_container);
+      item_name = mc.name;
+      added = addOrUpdateEmrItem(mc, emr_containers::MAP, item_container.maintainer, update_time, changed);
     }
     else if (item_container.type == emr_containers::COMPONENT) 
     {
       // Deserialize into an temoto_context_manager::ComponentContainer object and add to EMR
       temoto_context_manager::ComponentContainer cc = 
         temoto_core::deserializeROSmsg<temoto_context_manager::ComponentContainer>(item_container.serialized_container);
-      if (!addOrUpdateEmrItem(cc, emr_containers::COMPONENT, item_container.maintainer, update_time)) failed_items.push_back(item_container);
+      item_name = cc.name;
+      added = addOrUpdateEmrItem(cc, emr_containers::COMPONENT, item_container.maintainer, update_time, changed);
     }
     else if (item_container.type == emr_containers::ROBOT) 
     {
       // Deserialize into an temoto_context_manager::ComponentContainer object and add to EMR
       temoto_context_manager::RobotContainer cc = 
         temoto_core::deserializeROSmsg<temoto_context_manager::RobotContainer>(item_container.serialized_container);
-      if (!addOrUpdateEmrItem(cc, emr_containers::ROBOT, item_container.maintainer, update_time)) failed_items.push_back(item_container);
+      item_name = cc.name;
+      added = addOrUpdateEmrItem(cc, emr_containers::ROBOT, item_container.maintainer, update_time, changed);
     }
     else
     {
       ROS_ERROR_STREAM("Wrong type " << item_container.type.c_str() << "specified for EMR item");
+    }
+
+    if (!added)
+    {
       failed_items.push_back(item_container);
     }
+    else if (changed && wal_)
+    {
+      // The applied payload is logged, since it carries the stamp and the maintainer of the item
+      temoto_context_manager::ItemContainer applied_item;
+      std::shared_ptr<emr::Item> item = env_model_repository_.getItemByName(temoto_core::common::toSnakeCase(item_name));
+      if (item && itemToContainer(*item, applied_item))
+      {
+        wal_->appendItemUpdate(applied_item);
+      }
+    }
   }
 
   return failed_items;
@@ -191,7 +216,7 @@ std::vector<temoto_context_manager::ItemContainer> EmrRosInterface::updateEmr(
 
 std::vector<temoto_context_manager::ItemContainer> EmrRosInterface::EmrToVector()
 {
-  std::lock_guard<std::mutex> lock(emr_iface_mutex);
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
   std::vector<temoto_context_manager::ItemContainer> items;
   std::vector<std::shared_ptr<emr::Item>> root_items = env_model_repository_.getRootItems();
   for (const auto& item : root_items)
@@ -201,67 +226,997 @@ std::vector<temoto_context_manager::ItemContainer> EmrRosInterface::EmrToVector(
   return items;
 }
 
+std::vector<temoto_context_manager::ItemContainer> EmrRosInterface::EmrToVector(const std::string& root,
+                                                                                uint32_t max_depth,
+                                                                                const std::string& type,
+                                                                                const std::string& cursor,
+                                                                                size_t page_size,
+                                                                                std::string& next_cursor,
+                                                                                bool& success)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  std::vector<temoto_context_manager::ItemContainer> items;
+  next_cursor.clear();
+
+  std::vector<std::shared_ptr<emr::Item>> start_items;
+  if (root.empty())
+  {
+    start_items = env_model_repository_.getRootItems();
+  }
+  else if (std::shared_ptr<emr::Item> root_item = env_model_repository_.getItemByName(temoto_core::common::toSnakeCase(root)))
+  {
+    start_items.push_back(root_item);
+  }
+  else
+  {
+    success = false;
+    return items;
+  }
+
+  // Iterative depth-first traversal, which continues from the cursor item
+  std::vector<std::pair<std::shared_ptr<emr::Item>, uint32_t>> stack;
+  if (cursor.empty())
+  {
+    for (auto item_it = start_items.rbegin(); item_it != start_items.rend(); ++item_it)
+    {
+      stack.emplace_back(*item_it, 1);
+    }
+  }
+  else if (!seekTraversal(start_items, !root.empty(), max_depth, temoto_core::common::toSnakeCase(cursor), stack))
+  {
+    success = false;
+    return items;
+  }
+
+  std::string last_name;
+  while (!stack.empty())
+  {
+    std::shared_ptr<emr::Item> item = stack.back().first;
+    const uint32_t depth = stack.back().second;
+    stack.pop_back();
+
+    const std::string name = temoto_core::common::toSnakeCase(item->getName());
+    if (type.empty() || item->getPayload()->getType() == type)
+    {
+      if (page_size != 0 && items.size() == page_size)
+      {
+        next_cursor = last_name;
+        break;
+      }
+      temoto_context_manager::ItemContainer ic;
+      if (itemToContainer(*item, ic))
+      {
+        items.push_back(ic);
+        last_name = name;
+      }
+    }
+
+    if (max_depth == 0 || depth < max_depth)
+    {
+      const auto& children = item->getChildren();
+      for (auto child_it = children.rbegin(); child_it != children.rend(); ++child_it)
+      {
+        stack.emplace_back(*child_it, depth + 1);
+      }
+    }
+  }
+
+  success = true;
+  return items;
+}
+
+bool EmrRosInterface::seekTraversal(const std::vector<std::shared_ptr<emr::Item>>& start_items,
+                                    bool subtree,
+                                    uint32_t max_depth,
+                                    const std::string& cursor,
+                                    std::vector<std::pair<std::shared_ptr<emr::Item>, uint32_t>>& stack)
+{
+  std::shared_ptr<emr::Item> cursor_item = env_model_repository_.getItemByName(cursor);
+  if (!cursor_item)
+  {
+    return false;
+  }
+
+  // Path from the start item down to the cursor item
+  std::vector<std::shared_ptr<emr::Item>> path{cursor_item};
+  while (!(subtree ? path.back() == start_items.front() : !path.back()->getParent().lock()))
+  {
+    std::shared_ptr<emr::Item> parent = path.back()->getParent().lock();
+    if (!parent)
+    {
+      // The cursor is outside of the traversed subtree
+      return false;
+    }
+    path.push_back(parent);
+  }
+  std::reverse(path.begin(), path.end());
+  if (max_depth != 0 && path.size() > max_depth)
+  {
+    return false;
+  }
+
+  /*
+   * Restore the stack as it was right after the cursor item was visited: the siblings that follow
+   * the path on every level and the children of the cursor item
+   */
+  stack.clear();
+  for (size_t level = 0; level < path.size(); level++)
+  {
+    const std::vector<std::shared_ptr<emr::Item>>& siblings = level == 0
+      ? start_items
+      : path[level - 1]->getChildren();
+    auto path_it = std::find(siblings.begin(), siblings.end(), path[level]);
+    if (path_it == siblings.end())
+    {
+      return false;
+    }
+    for (auto sibling_it = siblings.rbegin(); sibling_it.base() != path_it + 1; ++sibling_it)
+    {
+      stack.emplace_back(*sibling_it, level + 1);
+    }
+  }
+  if (max_depth == 0 || path.size() < max_depth)
+  {
+    const auto& children = cursor_item->getChildren();
+    for (auto child_it = children.rbegin(); child_it != children.rend(); ++child_it)
+    {
+      stack.emplace_back(*child_it, path.size() + 1);
+    }
+  }
+  return true;
+}
+
 void EmrRosInterface::EmrToVectorHelper(const emr::Item& currentItem, std::vector<temoto_context_manager::ItemContainer>& items)
 {
   // Create empty container and fill it based on the payload
   temoto_context_manager::ItemContainer ic;
-  
-  ic.type = currentItem.getPayload()->getType();
+  if (!itemToContainer(currentItem, ic))
+  {
+    ROS_ERROR_STREAM("Wrong type of container @ EmrToVectorHelper: " << ic.type);
+    return;
+  }
+  items.push_back(ic);
+
+  std::vector<std::shared_ptr<emr::Item>> children = currentItem.getChildren();
+  for (uint32_t i = 0; i < children.size(); i++)
+  {
+    EmrToVectorHelper(*children[i], items);
+  }
+
+}
+
+bool EmrRosInterface::itemToContainer(const emr::Item& item, temoto_context_manager::ItemContainer& ic)
+{
+  ic.type = item.getPayload()->getType();
 
   // Get the item payload as ROS msg
   // To do this we dynamically cast the base class to the appropriate
   //   derived class and call the getPayload() method
   if (ic.type == emr_containers::OBJECT) 
   {
-    std::shared_ptr<RosPayload<temoto_context_manager::ObjectContainer>> rospl = 
-      std::dynamic_pointer_cast<RosPayload<temoto_context_manager::ObjectContainer>>(currentItem.getPayload());
-    ic.serialized_container = temoto_core::serializeROSmsg(rospl->getPayload());
-    ic.maintainer = rospl->getMaintainer();
-    items.push_back(ic);
-
+    serializePayload<temoto_context_manager::ObjectContainer>(item, ic);
   }
   else if (ic.type == emr_containers::MAP) 
   {
-    std::shared_ptr<RosPayload<temoto_context_manager::MapContainer>> rospl = 
-      std::dynamic_pointer_cast<RosPayload<temoto_context_manager::MapContainer>>(currentItem.getPayload());
-    ic.serialized_container = temoto_core::serializeROSmsg(rospl->getPayload());
-    ic.maintainer = rospl->getMaintainer();
-    items.push_back(ic);
-
+    serializePayload<temoto_context_manager::MapContainer>(item, ic);
   }
   else if (ic.type == emr_containers::COMPONENT) 
   {
-    std::shared_ptr<RosPayload<temoto_context_manager::ComponentContainer>> rospl = 
-      std::dynamic_pointer_cast<RosPayload<temoto_context_manager::ComponentContainer>>(currentItem.getPayload());
-    ic.serialized_container = temoto_core::serializeROSmsg(rospl->getPayload());
-    ic.maintainer = rospl->getMaintainer();
-    items.push_back(ic);
-
+    serializePayload<temoto_context_manager::ComponentContainer>(item, ic);
   }
   else if (ic.type == emr_containers::ROBOT) 
   {
-    std::shared_ptr<RosPayload<temoto_context_manager::RobotContainer>> rospl = 
-      std::dynamic_pointer_cast<RosPayload<temoto_context_manager::RobotContainer>>(currentItem.getPayload());
-    ic.serialized_container = temoto_core::serializeROSmsg(rospl->getPayload());
-    ic.maintainer = rospl->getMaintainer();
-    items.push_back(ic);
-
+    serializePayload<temoto_context_manager::RobotContainer>(item, ic);
   }
   else
   {
-    ROS_ERROR_STREAM("Wrong type of container @ EmrToVectorHelper: " << ic.type);
+    return false;
+  }
+  const std::string name = temoto_core::common::toSnakeCase(item.getName());
+  const auto version_it = item_versions_.find(name);
+  ic.version = version_it != item_versions_.end() ? version_it->second : 0;
+  ic.stale = stale_items_.count(name) != 0;
+  return true;
+}
+
+std::vector<temoto_context_manager::ItemContainer> EmrRosInterface::getItems(const std::vector<std::string>& names,
+                                                                              std::vector<bool>& found)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  std::vector<temoto_context_manager::ItemContainer> items(names.size());
+  found.assign(names.size(), false);
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    std::shared_ptr<emr::Item> item = env_model_repository_.getItemByName(temoto_core::common::toSnakeCase(names[i]));
+    if (item)
+    {
+      found[i] = itemToContainer(*item, items[i]);
+    }
+  }
+  return items;
+}
+
+void EmrRosInterface::setWriteAheadLog(std::shared_ptr<EmrWriteAheadLog> wal)
+{
+  std::lock_guard<std::shared_timed_mutex> lock(emr_iface_mutex);
+  wal_ = wal;
+}
+
+void EmrRosInterface::setChangeCallback(ChangeCallback callback)
+{
+  std::lock_guard<std::shared_timed_mutex> lock(emr_iface_mutex);
+  change_callback_ = callback;
+}
+
+void EmrRosInterface::notifyChange(uint8_t action, const std::string& name)
+{
+  std::shared_ptr<emr::Item> item = env_model_repository_.getItemByName(name);
+  if (!item)
+  {
     return;
   }
 
-  std::vector<std::shared_ptr<emr::Item>> children = currentItem.getChildren();
-  for (uint32_t i = 0; i < children.size(); i++)
+  const uint64_t version = ++change_counter_;
+  if (action == EmrEvent::REMOVED)
   {
-    EmrToVectorHelper(*children[i], items);
+    item_versions_.erase(name);
+  }
+  else
+  {
+    item_versions_[name] = version;
   }
 
+  if (history_)
+  {
+    recordHistory(action, *item);
+  }
+  if (change_callback_)
+  {
+    change_callback_(action, *item, version);
+  }
 }
+
 void EmrRosInterface::removeItem(const std::string& name)
 {
+  std::lock_guard<std::shared_timed_mutex> lock(emr_iface_mutex);
+  removeItemUnsafe(name);
+}
+
+void EmrRosInterface::removeItemUnsafe(const std::string& name)
+{
+  std::vector<std::shared_ptr<emr::Item>> orphans;
+  if (std::shared_ptr<emr::Item> item = env_model_repository_.getItemByName(name))
+  {
+    notifyChange(EmrEvent::REMOVED, name);
+    removeWorldTransforms(item);
+    attribute_index_.remove(name);
+    removeFromTagIndex(name);
+    pose_histories_.erase(name);
+    expiry_wheel_.cancel(name);
+    stale_items_.erase(name);
+    orphans = item->getChildren();
+    if (wal_)
+    {
+      wal_->appendItemRemoval(name);
+    }
+  }
   env_model_repository_.removeItem(name);
+
+  // The children of the removed item became root items, so their descendants are now indexed in their frames
+  for (const auto& orphan : orphans)
+  {
+    for (const auto& child : orphan->getChildren())
+    {
+      updateWorldTransforms(temoto_core::common::toSnakeCase(child->getName()));
+    }
+  }
+}
+
+bool EmrRosInterface::getItemPose(const emr::Item& item, geometry_msgs::PoseStamped& pose)
+{
+  const std::string& type = item.getPayload()->getType();
+  if (type == emr_containers::OBJECT)
+  {
+    pose = std::dynamic_pointer_cast<RosPayload<ObjectContainer>>(item.getPayload())->getPayloadRef().pose;
+  }
+  else if (type == emr_containers::MAP)
+  {
+    pose = std::dynamic_pointer_cast<RosPayload<MapContainer>>(item.getPayload())->getPayloadRef().pose;
+  }
+  else if (type == emr_containers::COMPONENT)
+  {
+    pose = std::dynamic_pointer_cast<RosPayload<ComponentContainer>>(item.getPayload())->getPayloadRef().pose;
+  }
+  else if (type == emr_containers::ROBOT)
+  {
+    pose = std::dynamic_pointer_cast<RosPayload<RobotContainer>>(item.getPayload())->getPayloadRef().pose;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+tf::Transform EmrRosInterface::getItemTransform(const emr::Item& item, ros::Time& stamp)
+{
+  geometry_msgs::PoseStamped pose;
+  if (!getItemPose(item, pose))
+  {
+    stamp = ros::Time();
+    return tf::Transform::getIdentity();
+  }
+  stamp = pose.header.stamp;
+
+  // Containers that were never given a pose have an all-zero quaternion
+  geometry_msgs::Quaternion& q = pose.pose.orientation;
+  if (q.x == 0 && q.y == 0 && q.z == 0 && q.w == 0)
+  {
+    q.w = 1;
+  }
+  tf::Transform transform;
+  tf::poseMsgToTF(pose.pose, transform);
+  return transform;
+}
+
+void EmrRosInterface::updateWorldTransforms(const std::string& name)
+{
+  std::shared_ptr<emr::Item> item = env_model_repository_.getItemByName(name);
+
+  // Root items define the frames, the poses of their descendants do not depend on them
+  if (!item || item->isRoot())
+  {
+    return;
+  }
+
+  std::shared_ptr<emr::Item> parent = item->getParent().lock();
+  tf::Transform parent_transform = tf::Transform::getIdentity();
+  std::string root;
+  if (parent->isRoot())
+  {
+    root = temoto_core::common::toSnakeCase(parent->getName());
+  }
+  else
+  {
+    const std::string parent_name = temoto_core::common::toSnakeCase(parent->getName());
+    const auto parent_it = world_transforms_.find(parent_name);
+    if (parent_it == world_transforms_.end())
+    {
+      // The parent is not composed yet, which also covers this item
+      updateWorldTransforms(parent_name);
+      return;
+    }
+    parent_transform = parent_it->second.transform;
+    root = parent_it->second.root;
+  }
+
+  auto index_it = spatial_indexes_.find(root);
+  if (index_it == spatial_indexes_.end())
+  {
+    index_it = spatial_indexes_.emplace(root, emr::SpatialIndex(spatial_cell_size_)).first;
+  }
+  updateWorldTransformsHelper(*item, parent_transform, root, index_it->second);
+}
+
+void EmrRosInterface::updateWorldTransformsHelper(const emr::Item& item,
+                                                  const tf::Transform& parent_transform,
+                                                  const std::string& root,
+                                                  emr::SpatialIndex& index)
+{
+  const std::string name = temoto_core::common::toSnakeCase(item.getName());
+  WorldTransform& world_transform = world_transforms_[name];
+  world_transform.root = root;
+  world_transform.transform = parent_transform * getItemTransform(item, world_transform.stamp);
+
+  const tf::Vector3& origin = world_transform.transform.getOrigin();
+  index.update(name, emr::SpatialIndex::Position{origin.x(), origin.y(), origin.z()});
+
+  for (const auto& child : item.getChildren())
+  {
+    updateWorldTransformsHelper(*child, world_transform.transform, root, index);
+  }
+}
+
+void EmrRosInterface::removeWorldTransforms(const std::shared_ptr<emr::Item>& item)
+{
+  const std::string name = temoto_core::common::toSnakeCase(item->getName());
+  emr::SpatialIndex* index = nullptr;
+  if (item->isRoot())
+  {
+    spatial_indexes_.erase(name);
+  }
+  else
+  {
+    const auto transform_it = world_transforms_.find(name);
+    if (transform_it != world_transforms_.end())
+    {
+      const auto index_it = spatial_indexes_.find(transform_it->second.root);
+      if (index_it != spatial_indexes_.end())
+      {
+        index = &index_it->second;
+      }
+    }
+  }
+
+  std::vector<std::shared_ptr<emr::Item>> subtree {item};
+  while (!subtree.empty())
+  {
+    std::shared_ptr<emr::Item> current = subtree.back();
+    subtree.pop_back();
+    const std::string current_name = temoto_core::common::toSnakeCase(current->getName());
+    world_transforms_.erase(current_name);
+    if (index)
+    {
+      index->remove(current_name);
+    }
+    subtree.insert(subtree.end(), current->getChildren().begin(), current->getChildren().end());
+  }
+}
+
+bool EmrRosInterface::getWorldPoseUnsafe(const std::string& name, geometry_msgs::PoseStamped& pose)
+{
+  const std::string snake_name = temoto_core::common::toSnakeCase(name);
+  const auto transform_it = world_transforms_.find(snake_name);
+  if (transform_it != world_transforms_.end())
+  {
+    pose.header.frame_id = transform_it->second.root;
+    pose.header.stamp = transform_it->second.stamp;
+    tf::poseTFToMsg(transform_it->second.transform, pose.pose);
+    return true;
+  }
+
+  // A root item is the origin of its own frame
+  if (env_model_repository_.hasItem(snake_name))
+  {
+    pose = geometry_msgs::PoseStamped();
+    pose.header.frame_id = snake_name;
+    pose.pose.orientation.w = 1;
+    return true;
+  }
+  return false;
+}
+
+bool EmrRosInterface::getWorldPose(const std::string& name, geometry_msgs::PoseStamped& pose)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  return getWorldPoseUnsafe(name, pose);
+}
+
+std::vector<geometry_msgs::PoseStamped> EmrRosInterface::getWorldPoses(const std::vector<std::string>& names,
+                                                                       std::vector<bool>& found)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  std::vector<geometry_msgs::PoseStamped> poses(names.size());
+  found.assign(names.size(), false);
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    found[i] = getWorldPoseUnsafe(names[i], poses[i]);
+  }
+  return poses;
+}
+
+void EmrRosInterface::addContainerAttributes(const ObjectContainer& container,
+                                             emr::AttributeIndex::Attributes& attributes)
+{
+  for (const auto& detection_method : container.detection_methods)
+  {
+    attributes.emplace_back(emr_attributes::DETECTION_METHOD, detection_method);
+  }
+}
+
+void EmrRosInterface::addContainerAttributes(const MapContainer& container,
+                                             emr::AttributeIndex::Attributes& attributes)
+{
+  for (const auto& detection_method : container.detection_methods)
+  {
+    attributes.emplace_back(emr_attributes::DETECTION_METHOD, detection_method);
+  }
+}
+
+void EmrRosInterface::addContainerAttributes(const ComponentContainer& container,
+                                             emr::AttributeIndex::Attributes& attributes)
+{
+  (void)container;
+  (void)attributes;
+}
+
+void EmrRosInterface::addContainerAttributes(const RobotContainer& container,
+                                             emr::AttributeIndex::Attributes& attributes)
+{
+  for (const auto& detection_method : container.detection_methods)
+  {
+    attributes.emplace_back(emr_attributes::DETECTION_METHOD, detection_method);
+  }
+  attributes.emplace_back(emr_attributes::ODOM_FRAME_ID, container.odom_frame_id);
+  attributes.emplace_back(emr_attributes::BASE_FRAME_ID, container.base_frame_id);
+}
+
+void EmrRosInterface::updateTagIndex(const std::string& name, const ObjectContainer& container)
+{
+  const bool has_tag = std::find(container.detection_methods.begin(),
+                                 container.detection_methods.end(),
+                                 ObjectContainer::ARTAG) != container.detection_methods.end();
+
+  auto item_tag_it = item_tags_.find(name);
+  if (item_tag_it != item_tags_.end())
+  {
+    if (has_tag && item_tag_it->second == container.tag_id)
+    {
+      return;
+    }
+    removeFromTagIndex(name);
+  }
+  if (!has_tag)
+  {
+    return;
+  }
+
+  auto tag_it = tag_index_.find(container.tag_id);
+  if (tag_it != tag_index_.end() && tag_it->second != name)
+  {
+    ROS_WARN_STREAM("AR tag " << container.tag_id << " moves from object " << tag_it->second << " to " << name);
+    item_tags_.erase(tag_it->second);
+  }
+  tag_index_[container.tag_id] = name;
+  item_tags_[name] = container.tag_id;
+}
+
+void EmrRosInterface::removeFromTagIndex(const std::string& name)
+{
+  auto item_tag_it = item_tags_.find(name);
+  if (item_tag_it == item_tags_.end())
+  {
+    return;
+  }
+  tag_index_.erase(item_tag_it->second);
+  item_tags_.erase(item_tag_it);
+}
+
+void EmrRosInterface::configurePoseHistory(size_t length, double horizon)
+{
+  std::lock_guard<std::shared_timed_mutex> lock(emr_iface_mutex);
+  pose_history_length_ = length;
+  pose_history_horizon_ = ros::Duration(horizon);
+  pose_histories_.clear();
+}
+
+void EmrRosInterface::recordPose(const std::string& name, const geometry_msgs::PoseStamped& pose)
+{
+  if (pose_history_length_ == 0)
+  {
+    return;
+  }
+  auto history_it = pose_histories_.find(name);
+  if (history_it == pose_histories_.end())
+  {
+    history_it = pose_histories_.emplace(name, PoseHistory(pose_history_length_, pose_history_horizon_)).first;
+  }
+  history_it->second.add(pose);
+}
+
+void EmrRosInterface::configureTtl(const std::map<std::string, double>& ttls, bool expire, double resolution)
+{
+  std::lock_guard<std::shared_timed_mutex> lock(emr_iface_mutex);
+  ttls_.clear();
+  for (const auto& ttl : ttls)
+  {
+    // Container types are kept as they are, item names are stored like the EMR stores them
+    if (ttl.first == emr_containers::OBJECT || ttl.first == emr_containers::MAP ||
+        ttl.first == emr_containers::COMPONENT || ttl.first == emr_containers::ROBOT)
+    {
+      ttls_[ttl.first] = ttl.second;
+    }
+    else
+    {
+      ttls_[temoto_core::common::toSnakeCase(ttl.first)] = ttl.second;
+    }
+  }
+  expire_stale_items_ = expire;
+  expiry_resolution_ = resolution > 0 ? resolution : 0.1;
+  expiry_wheel_ = emr::TimerWheel();
+  expiry_wheel_.advance(static_cast<uint64_t>(ros::Time::now().toSec() / expiry_resolution_));
+  stale_items_.clear();
+
+  if (ttls_.empty())
+  {
+    expiry_timer_.stop();
+    return;
+  }
+  expiry_timer_ = nh_.createTimer(ros::Duration(expiry_resolution_), &EmrRosInterface::expiryTimerCallback, this);
+}
+
+bool EmrRosInterface::isStale(const std::string& name)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  return stale_items_.count(temoto_core::common::toSnakeCase(name)) != 0;
+}
+
+void EmrRosInterface::scheduleExpiry(const std::string& name)
+{
+  if (ttls_.empty())
+  {
+    return;
+  }
+  std::shared_ptr<emr::Item> item = env_model_repository_.getItemByName(name);
+  if (!item)
+  {
+    return;
+  }
+
+  auto ttl_it = ttls_.find(name);
+  if (ttl_it == ttls_.end())
+  {
+    ttl_it = ttls_.find(item->getPayload()->getType());
+  }
+  if (ttl_it == ttls_.end() || ttl_it->second <= 0)
+  {
+    expiry_wheel_.cancel(name);
+    stale_items_.erase(name);
+    return;
+  }
+
+  // Poses without a timestamp age from the moment they were written
+  const ros::Time now = ros::Time::now();
+  geometry_msgs::PoseStamped pose;
+  const ros::Time stamp = getItemPose(*item, pose) && !pose.header.stamp.isZero() ? pose.header.stamp : now;
+  const double deadline = stamp.toSec() + ttl_it->second;
+  if (deadline > now.toSec())
+  {
+    stale_items_.erase(name);
+  }
+
+  // A deadline that has already passed, e.g. of an item restored from a snapshot, expires on the next tick
+  expiry_wheel_.schedule(name, static_cast<uint64_t>(std::ceil(deadline / expiry_resolution_)));
+}
+
+void EmrRosInterface::expiryTimerCallback(const ros::TimerEvent&)
+{
+  std::lock_guard<std::shared_timed_mutex> lock(emr_iface_mutex);
+  const uint64_t now = static_cast<uint64_t>(ros::Time::now().toSec() / expiry_resolution_);
+  for (const std::string& name : expiry_wheel_.advance(now))
+  {
+    if (!env_model_repository_.hasItem(name))
+    {
+      continue;
+    }
+    if (expire_stale_items_)
+    {
+      ROS_INFO_STREAM("Removing the expired item: " << name);
+      removeItemUnsafe(name);
+    }
+    else if (stale_items_.insert(name).second)
+    {
+      ROS_DEBUG_STREAM("The pose of " << name << " has gone stale");
+      notifyChange(EmrEvent::UPDATED, name);
+    }
+  }
+}
+
+void EmrRosInterface::configureHistory(double retention, size_t max_versions)
+{
+  std::lock_guard<std::shared_timed_mutex> lock(emr_iface_mutex);
+  if (retention <= 0)
+  {
+    history_.reset();
+    return;
+  }
+  history_.reset(new EmrHistory(ros::Duration(retention), max_versions));
+  for (const auto& item_entry : env_model_repository_.getItems())
+  {
+    recordHistory(EmrEvent::ADDED, *item_entry.second);
+  }
+}
+
+void EmrRosInterface::recordHistory(uint8_t action, const emr::Item& item)
+{
+  const std::string name = temoto_core::common::toSnakeCase(item.getName());
+  if (action == EmrEvent::REMOVED)
+  {
+    history_->erase(name, ros::Time::now());
+    return;
+  }
+
+  EmrHistory::Entry entry;
+  if (!itemToContainer(item, entry.item))
+  {
+    return;
+  }
+  if (std::shared_ptr<emr::Item> parent = item.getParent().lock())
+  {
+    entry.parent = temoto_core::common::toSnakeCase(parent->getName());
+  }
+  history_->put(name, entry, ros::Time::now());
+}
+
+std::vector<ItemContainer> EmrRosInterface::getEmrAt(uint64_t version,
+                                                     const ros::Time& stamp,
+                                                     const std::string& root,
+                                                     uint32_t max_depth,
+                                                     EmrHistory::Version& found_version,
+                                                     bool& success)
+{
+  std::vector<ItemContainer> items;
+  success = false;
+  if (!history_)
+  {
+    return items;
+  }
+  if (version != 0 || stamp.isZero())
+  {
+    success = history_->getVersion(version, found_version);
+  }
+  else
+  {
+    success = history_->getVersionAt(stamp, found_version);
+  }
+  if (!success)
+  {
+    return items;
+  }
+
+  // The version only knows the parents, so gather the children once. Items whose parent was
+  // removed are roots, as they are in the EMR itself
+  const EmrHistory::State& state = found_version.state;
+  std::map<std::string, std::vector<std::string>> children;
+  state.forEach([&](const std::string& name, const EmrHistory::Entry& entry)
+  {
+    children[!entry.parent.empty() && state.find(entry.parent) ? entry.parent : std::string()].push_back(name);
+  });
+
+  std::vector<std::pair<std::string, uint32_t>> stack;
+  const std::string root_name = temoto_core::common::toSnakeCase(root);
+  if (root_name.empty())
+  {
+    std::vector<std::string>& roots = children[""];
+    std::sort(roots.begin(), roots.end());
+    for (auto root_it = roots.rbegin(); root_it != roots.rend(); ++root_it)
+    {
+      stack.emplace_back(*root_it, 1);
+    }
+  }
+  else if (state.find(root_name))
+  {
+    stack.emplace_back(root_name, 1);
+  }
+  else
+  {
+    success = false;
+    return items;
+  }
+
+  items.reserve(state.size());
+  while (!stack.empty())
+  {
+    const std::pair<std::string, uint32_t> current = stack.back();
+    stack.pop_back();
+    items.push_back(state.find(current.first)->item);
+    if (max_depth != 0 && current.second >= max_depth)
+    {
+      continue;
+    }
+    auto children_it = children.find(current.first);
+    if (children_it == children.end())
+    {
+      continue;
+    }
+    std::sort(children_it->second.begin(), children_it->second.end());
+    for (auto child_it = children_it->second.rbegin(); child_it != children_it->second.rend(); ++child_it)
+    {
+      stack.emplace_back(*child_it, current.second + 1);
+    }
+  }
+  return items;
+}
+
+uint64_t EmrRosInterface::pinVersion(uint64_t version)
+{
+  return history_ ? history_->pin(version) : 0;
+}
+
+bool EmrRosInterface::unpinVersion(uint64_t version)
+{
+  return history_ && history_->unpin(version);
+}
+
+bool EmrRosInterface::getPoseAt(const std::string& name, const ros::Time& stamp, geometry_msgs::PoseStamped& pose)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  const auto history_it = pose_histories_.find(temoto_core::common::toSnakeCase(name));
+  return history_it != pose_histories_.end() && history_it->second.getPoseAt(stamp, pose);
+}
+
+std::vector<geometry_msgs::PoseStamped> EmrRosInterface::getPosesAt(const std::vector<std::string>& names,
+                                                                    const std::vector<ros::Time>& stamps,
+                                                                    std::vector<bool>& found)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  std::vector<geometry_msgs::PoseStamped> poses(names.size());
+  found.assign(names.size(), false);
+  if (stamps.size() != 1 && stamps.size() != names.size())
+  {
+    ROS_ERROR_STREAM("Expected either one time or one time per item, got " << stamps.size() << " times for " << names.size() << " items");
+    return poses;
+  }
+
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    const auto history_it = pose_histories_.find(temoto_core::common::toSnakeCase(names[i]));
+    if (history_it != pose_histories_.end())
+    {
+      found[i] = history_it->second.getPoseAt(stamps.size() == 1 ? stamps[0] : stamps[i], poses[i]);
+    }
+  }
+  return poses;
+}
+
+std::vector<TaggedObject> EmrRosInterface::getObjectsByTagIds(const std::vector<int16_t>& tag_ids, std::vector<bool>& found)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  std::vector<TaggedObject> objects(tag_ids.size());
+  found.assign(tag_ids.size(), false);
+  for (size_t i = 0; i < tag_ids.size(); i++)
+  {
+    const auto tag_it = tag_index_.find(tag_ids[i]);
+    if (tag_it == tag_index_.end())
+    {
+      continue;
+    }
+    std::shared_ptr<emr::Item> item = env_model_repository_.getItemByName(tag_it->second);
+    if (!item)
+    {
+      continue;
+    }
+    const auto payload = std::dynamic_pointer_cast<RosPayload<ObjectContainer>>(item->getPayload());
+    if (!payload)
+    {
+      continue;
+    }
+    const ObjectContainer& container = payload->getPayloadRef();
+    objects[i].name = container.name;
+    objects[i].pose = container.pose;
+    objects[i].obj_relative_pose = container.obj_relative_pose;
+    found[i] = true;
+  }
+  return objects;
+}
+
+std::vector<std::string> EmrRosInterface::queryItems(const emr::AttributeIndex::Attributes& constraints,
+                                                     const std::string& subtree_root,
+                                                     const std::string& cursor,
+                                                     size_t page_size,
+                                                     std::string& next_cursor,
+                                                     std::vector<ItemContainer>* items)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  next_cursor.clear();
+  if (page_size == 0)
+  {
+    return std::vector<std::string>();
+  }
+
+  emr::AttributeIndex::Filter in_subtree;
+  if (!subtree_root.empty())
+  {
+    std::shared_ptr<emr::Item> root = env_model_repository_.getItemByName(temoto_core::common::toSnakeCase(subtree_root));
+    if (!root)
+    {
+      return std::vector<std::string>();
+    }
+    in_subtree = [&](const std::string& name)
+    {
+      for (std::shared_ptr<emr::Item> item = env_model_repository_.getItemByName(name);
+           item;
+           item = item->getParent().lock())
+      {
+        if (item == root)
+        {
+          return true;
+        }
+      }
+      return false;
+    };
+  }
+
+  // Fetch one extra name to find out whether there is a next page
+  std::vector<std::string> names = attribute_index_.query(constraints, cursor, page_size + 1, in_subtree);
+  if (names.size() > page_size)
+  {
+    names.pop_back();
+    next_cursor = names.back();
+  }
+
+  if (items)
+  {
+    items->resize(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      itemToContainer(*env_model_repository_.getItemByName(names[i]), (*items)[i]);
+    }
+  }
+  return names;
+}
+
+template <class Search>
+std::vector<SpatialMatch> EmrRosInterface::searchSpatialIndexes(const std::string& frame_id, Search search)
+{
+  std::shared_lock<std::shared_timed_mutex> lock(emr_iface_mutex);
+  std::vector<SpatialMatch> matches;
+  auto collect = [&](const std::string& root_name, const emr::SpatialIndex& index)
+  {
+    for (const auto& match : search(index))
+    {
+      SpatialMatch spatial_match;
+      spatial_match.name = match.name;
+      spatial_match.frame_id = root_name;
+      spatial_match.position.x = match.position.x;
+      spatial_match.position.y = match.position.y;
+      spatial_match.position.z = match.position.z;
+      spatial_match.distance = match.distance;
+      matches.push_back(spatial_match);
+    }
+  };
+
+  if (frame_id.empty())
+  {
+    for (const auto& index : spatial_indexes_)
+    {
+      collect(index.first, index.second);
+    }
+    std::stable_sort(matches.begin(), matches.end(), [](const SpatialMatch& a, const SpatialMatch& b)
+    {
+      return a.distance < b.distance;
+    });
+  }
+  else
+  {
+    const auto index_it = spatial_indexes_.find(temoto_core::common::toSnakeCase(frame_id));
+    if (index_it != spatial_indexes_.end())
+    {
+      collect(index_it->first, index_it->second);
+    }
+  }
+  return matches;
 }
+
+std::vector<SpatialMatch> EmrRosInterface::radiusSearch(const std::string& frame_id,
+                                                        const geometry_msgs::Point& center,
+                                                        double radius)
+{
+  const emr::SpatialIndex::Position c{center.x, center.y, center.z};
+  return searchSpatialIndexes(frame_id, [&](const emr::SpatialIndex& index)
+  {
+    return index.radiusSearch(c, radius);
+  });
+}
+
+std::vector<SpatialMatch> EmrRosInterface::boxSearch(const std::string& frame_id,
+                                                     const geometry_msgs::Point& min_corner,
+                                                     const geometry_msgs::Point& max_corner)
+{
+  const emr::SpatialIndex::Position min_c{min_corner.x, min_corner.y, min_corner.z};
+  const emr::SpatialIndex::Position max_c{max_corner.x, max_corner.y, max_corner.z};
+  return searchSpatialIndexes(frame_id, [&](const emr::SpatialIndex& index)
+  {
+    return index.boxSearch(min_c, max_c);
+  });
+}
+
+std::vector<SpatialMatch> EmrRosInterface::nearestSearch(const std::string& frame_id,
+                                                         const geometry_msgs::Point& center,
+                                                         size_t k)
+{
+  const emr::SpatialIndex::Position c{center.x, center.y, center.z};
+  std::vector<SpatialMatch> matches = searchSpatialIndexes(frame_id, [&](const emr::SpatialIndex& index)
+  {
+    return index.nearestSearch(c, k);
+  });
+
+  // Each root contributed its own k nearest items
+  if (matches.size() > k)
+  {
+    matches.resize(k);
+  }
+  return matches;
+}
+
 } // namespace emr_ros_interface
\ No newline at end of file
@@ -0,0 +1,294 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "temoto_context_manager/emr_shared_memory.h"
+#include "temoto_context_manager/emr_snapshot.h"
+#include <ros/ros.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace temoto_context_manager
+{
+
+const char SHARED_MEMORY_MAGIC[8] = {'T', 'M', 'E', 'M', 'R', 'S', 'H', 'M'};
+
+constexpr uint32_t EmrSharedMemoryHeader::LAYOUT_VERSION;
+
+// How long a reader waits for the writer to finish a write before it gives up
+constexpr std::chrono::milliseconds READ_TIMEOUT(100);
+
+EmrSharedMemoryWriter::EmrSharedMemoryWriter(const std::string& name, size_t capacity)
+: name_(name)
+, header_(nullptr)
+, data_(nullptr)
+, mapped_size_(sizeof(EmrSharedMemoryHeader) + capacity)
+{
+  int fd = ::shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0)
+  {
+    ROS_ERROR_STREAM("Could not open the shared memory segment " << name_ << ": " << std::strerror(errno));
+    return;
+  }
+
+  /*
+   * A segment left behind by a previous writer is reused as long as its layout matches, so that
+   * its readers keep working. The segment is never shrunk, since the readers that have mapped it
+   * would get a SIGBUS when touching the truncated pages
+   */
+  struct stat segment_stat;
+  if (::fstat(fd, &segment_stat) != 0)
+  {
+    ROS_ERROR_STREAM("Could not inspect the shared memory segment " << name_ << ": " << std::strerror(errno));
+    ::close(fd);
+    return;
+  }
+  const bool has_header = size_t(segment_stat.st_size) >= sizeof(EmrSharedMemoryHeader);
+  if (size_t(segment_stat.st_size) < mapped_size_ && ::ftruncate(fd, mapped_size_) != 0)
+  {
+    ROS_ERROR_STREAM("Could not resize the shared memory segment " << name_ << ": " << std::strerror(errno));
+    ::close(fd);
+    return;
+  }
+
+  void* address = ::mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (address == MAP_FAILED)
+  {
+    ROS_ERROR_STREAM("Could not map the shared memory segment " << name_ << ": " << std::strerror(errno));
+    return;
+  }
+
+  header_ = static_cast<EmrSharedMemoryHeader*>(address);
+  data_ = static_cast<uint8_t*>(address) + sizeof(EmrSharedMemoryHeader);
+  const bool same_layout = has_header &&
+                          std::memcmp(header_->magic, SHARED_MEMORY_MAGIC, sizeof(header_->magic)) == 0 &&
+                          header_->layout_version == EmrSharedMemoryHeader::LAYOUT_VERSION;
+  if (same_layout && header_->capacity == capacity)
+  {
+    // A writer that crashed in the middle of a write left the sequence odd
+    uint64_t sequence = header_->sequence.load(std::memory_order_relaxed);
+    if (sequence % 2 == 1)
+    {
+      header_->sequence.store(sequence + 1, std::memory_order_release);
+    }
+  }
+  else
+  {
+    /*
+     * The sequence of a segment with the same layout keeps increasing, so that the readers that
+     * have mapped it notice the change. It stays odd while the header is rewritten, and the
+     * readers check the magic last, after the rest of the header is in place
+     */
+    uint64_t sequence = same_layout ? header_->sequence.load(std::memory_order_relaxed) : 0;
+    sequence += (sequence % 2 == 0) ? 1 : 0;
+    header_->sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memset(header_->magic, 0, sizeof(header_->magic));
+    header_->layout_version = EmrSharedMemoryHeader::LAYOUT_VERSION;
+    header_->capacity = capacity;
+    header_->size = 0;
+    header_->published_ns = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, SHARED_MEMORY_MAGIC, sizeof(header_->magic));
+    header_->sequence.store(sequence + 1, std::memory_order_release);
+  }
+}
+
+EmrSharedMemoryWriter::~EmrSharedMemoryWriter()
+{
+  if (header_)
+  {
+    ::munmap(header_, mapped_size_);
+  }
+}
+
+bool EmrSharedMemoryWriter::write(const Items& items, uint64_t version)
+{
+  if (!header_)
+  {
+    return false;
+  }
+  if (!EmrSnapshot::encode(items, version, buffer_))
+  {
+    return false;
+  }
+  if (buffer_.size() > header_->capacity)
+  {
+    ROS_ERROR_STREAM("The EMR snapshot (" << buffer_.size() << " bytes) does not fit into the shared memory segment "
+      << name_ << " (" << header_->capacity << " bytes)");
+    return false;
+  }
+
+  const uint64_t sequence = header_->sequence.load(std::memory_order_relaxed);
+  header_->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memcpy(data_, buffer_.data(), buffer_.size());
+  header_->size = buffer_.size();
+  header_->published_ns = ros::WallTime::now().toNSec();
+
+  header_->sequence.store(sequence + 2, std::memory_order_release);
+  return true;
+}
+
+EmrSharedMemoryReader::EmrSharedMemoryReader(const std::string& name)
+: name_(name)
+, header_(nullptr)
+, data_(nullptr)
+, mapped_size_(0)
+{
+  open();
+}
+
+EmrSharedMemoryReader::~EmrSharedMemoryReader()
+{
+  close();
+}
+
+bool EmrSharedMemoryReader::open()
+{
+  if (header_)
+  {
+    return true;
+  }
+
+  int fd = ::shm_open(name_.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat segment_stat;
+  if (::fstat(fd, &segment_stat) != 0 || size_t(segment_stat.st_size) < sizeof(EmrSharedMemoryHeader))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  mapped_size_ = segment_stat.st_size;
+  void* address = ::mmap(nullptr, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (address == MAP_FAILED)
+  {
+    return false;
+  }
+
+  header_ = static_cast<const EmrSharedMemoryHeader*>(address);
+  data_ = static_cast<const uint8_t*>(address) + sizeof(EmrSharedMemoryHeader);
+  if (std::memcmp(header_->magic, SHARED_MEMORY_MAGIC, sizeof(header_->magic)) != 0 ||
+      header_->layout_version != EmrSharedMemoryHeader::LAYOUT_VERSION ||
+      sizeof(EmrSharedMemoryHeader) + header_->capacity > mapped_size_)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void EmrSharedMemoryReader::close()
+{
+  if (header_)
+  {
+    ::munmap(const_cast<EmrSharedMemoryHeader*>(header_), mapped_size_);
+    header_ = nullptr;
+    data_ = nullptr;
+    mapped_size_ = 0;
+  }
+}
+
+uint64_t EmrSharedMemoryReader::getSequence()
+{
+  if (!open())
+  {
+    return 0;
+  }
+  return header_->sequence.load(std::memory_order_acquire);
+}
+
+uint64_t EmrSharedMemoryReader::read(const Visitor& visitor)
+{
+  if (!open())
+  {
+    return 0;
+  }
+
+  // A writer that died in the middle of a write leaves the sequence odd, hence the retries are bounded
+  const auto deadline = std::chrono::steady_clock::now() + READ_TIMEOUT;
+  do
+  {
+    const uint64_t sequence = header_->sequence.load(std::memory_order_acquire);
+    if (sequence == 0)
+    {
+      return 0;
+    }
+    if (sequence % 2 == 1)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // A restarted writer may have given the segment a new layout, which is mapped again on the next read
+    if (std::memcmp(header_->magic, SHARED_MEMORY_MAGIC, sizeof(header_->magic)) != 0 ||
+        header_->layout_version != EmrSharedMemoryHeader::LAYOUT_VERSION ||
+        sizeof(EmrSharedMemoryHeader) + header_->capacity > mapped_size_)
+    {
+      close();
+      return 0;
+    }
+
+    const uint64_t size = header_->size;
+    if (size == 0)
+    {
+      // The segment was initialized, but nothing has been published into it yet
+      return 0;
+    }
+    if (size <= header_->capacity)
+    {
+      visitor(data_, size);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->sequence.load(std::memory_order_relaxed) == sequence)
+    {
+      return sequence;
+    }
+  } while (std::chrono::steady_clock::now() < deadline);
+
+  ROS_WARN_STREAM("Timed out while waiting for the writer of the shared memory segment " << name_);
+  return 0;
+}
+
+uint64_t EmrSharedMemoryReader::readItems(Items& items, uint64_t& version)
+{
+  const uint64_t sequence = read([this](const uint8_t* data, size_t size)
+  {
+    buffer_.assign(data, data + size);
+  });
+  if (sequence == 0 || !EmrSnapshot::decode(buffer_.data(), buffer_.size(), items, version))
+  {
+    return 0;
+  }
+  return sequence;
+}
+
+} // temoto_context_manager namespace
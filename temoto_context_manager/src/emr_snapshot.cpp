@@ -0,0 +1,248 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "temoto_context_manager/emr_snapshot.h"
+#include <ros/ros.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace temoto_context_manager
+{
+
+const char SNAPSHOT_MAGIC[8] = {'T', 'M', 'E', 'M', 'R', 'S', 'N', 'P'};
+
+constexpr uint32_t EmrSnapshot::FORMAT_VERSION;
+
+bool EmrSnapshot::encode(const Items& items, uint64_t wal_sequence, std::vector<uint8_t>& buffer)
+{
+  // Compute the size of the data region beforehand, so that the buffer is allocated only once
+  uint64_t data_size = 0;
+  for (const auto& item : items)
+  {
+    data_size += item.type.size() + item.maintainer.size() + item.serialized_container.size();
+  }
+
+  // The offsets and sizes in the entries are 32-bit
+  if (data_size > std::numeric_limits<uint32_t>::max() || items.size() > std::numeric_limits<uint32_t>::max())
+  {
+    ROS_ERROR_STREAM("The EMR snapshot (" << items.size() << " items, " << data_size
+      << " bytes) exceeds the limits of the snapshot format");
+    buffer.clear();
+    return false;
+  }
+
+  const size_t table_offset = sizeof(Header);
+  const size_t data_offset = table_offset + items.size() * sizeof(Entry);
+  buffer.assign(data_offset + data_size, 0);
+
+  Header header;
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.format_version = FORMAT_VERSION;
+  header.item_count = items.size();
+  header.created_ns = ros::WallTime::now().toNSec();
+  header.wal_sequence = wal_sequence;
+  header.data_size = data_size;
+  std::memcpy(buffer.data(), &header, sizeof(Header));
+
+  uint32_t cursor = 0;
+  auto append = [&](const void* src, uint32_t size, uint32_t& offset_out, uint32_t& size_out)
+  {
+    offset_out = cursor;
+    size_out = size;
+    if (size != 0)
+    {
+      std::memcpy(buffer.data() + data_offset + cursor, src, size);
+    }
+    cursor += size;
+  };
+
+  for (size_t i = 0; i < items.size(); i++)
+  {
+    const ItemContainer& item = items[i];
+    Entry entry;
+    append(item.type.data(), item.type.size(), entry.type_offset, entry.type_size);
+    append(item.maintainer.data(), item.maintainer.size(), entry.maintainer_offset, entry.maintainer_size);
+    append(item.serialized_container.data(), item.serialized_container.size(), entry.container_offset, entry.container_size);
+    std::memcpy(buffer.data() + table_offset + i * sizeof(Entry), &entry, sizeof(Entry));
+  }
+  return true;
+}
+
+bool EmrSnapshot::decode(const uint8_t* data, size_t size, Items& items, uint64_t& wal_sequence)
+{
+  if (size < sizeof(Header))
+  {
+    ROS_ERROR_STREAM("EMR snapshot is too small to contain a header");
+    return false;
+  }
+
+  Header header;
+  std::memcpy(&header, data, sizeof(Header));
+  if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+  {
+    ROS_ERROR_STREAM("EMR snapshot has an invalid magic number");
+    return false;
+  }
+  if (header.format_version != FORMAT_VERSION)
+  {
+    ROS_ERROR_STREAM("Unsupported EMR snapshot format version: " << header.format_version);
+    return false;
+  }
+
+  const size_t table_offset = sizeof(Header);
+  const size_t data_offset = table_offset + size_t(header.item_count) * sizeof(Entry);
+  if (data_offset > size || header.data_size != size - data_offset)
+  {
+    ROS_ERROR_STREAM("EMR snapshot is truncated");
+    return false;
+  }
+
+  wal_sequence = header.wal_sequence;
+  const uint8_t* data_region = data + data_offset;
+  auto in_bounds = [&](uint32_t offset, uint32_t length)
+  {
+    return uint64_t(offset) + length <= header.data_size;
+  };
+
+  items.clear();
+  items.reserve(header.item_count);
+  for (uint32_t i = 0; i < header.item_count; i++)
+  {
+    Entry entry;
+    std::memcpy(&entry, data + table_offset + i * sizeof(Entry), sizeof(Entry));
+    if (!in_bounds(entry.type_offset, entry.type_size) ||
+        !in_bounds(entry.maintainer_offset, entry.maintainer_size) ||
+        !in_bounds(entry.container_offset, entry.container_size))
+    {
+      ROS_ERROR_STREAM("EMR snapshot entry " << i << " points outside of the data region");
+      items.clear();
+      return false;
+    }
+
+    ItemContainer item;
+    item.type.assign(reinterpret_cast<const char*>(data_region + entry.type_offset), entry.type_size);
+    item.maintainer.assign(reinterpret_cast<const char*>(data_region + entry.maintainer_offset), entry.maintainer_size);
+    item.serialized_container.assign(data_region + entry.container_offset,
+                                     data_region + entry.container_offset + entry.container_size);
+    items.push_back(std::move(item));
+  }
+  return true;
+}
+
+bool EmrSnapshot::write(const std::string& path, const Items& items, uint64_t wal_sequence)
+{
+  std::vector<uint8_t> buffer;
+  if (!encode(items, wal_sequence, buffer))
+  {
+    return false;
+  }
+
+  const std::string tmp_path = path + ".tmp";
+  int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    ROS_ERROR_STREAM("Could not open " << tmp_path << " for writing: " << std::strerror(errno));
+    return false;
+  }
+
+  size_t written = 0;
+  while (written < buffer.size())
+  {
+    ssize_t ret = ::write(fd, buffer.data() + written, buffer.size() - written);
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      ROS_ERROR_STREAM("Could not write the EMR snapshot: " << std::strerror(errno));
+      ::close(fd);
+      ::unlink(tmp_path.c_str());
+      return false;
+    }
+    written += ret;
+  }
+
+  if (::fsync(fd) != 0 || ::close(fd) != 0)
+  {
+    ROS_ERROR_STREAM("Could not flush the EMR snapshot: " << std::strerror(errno));
+    ::unlink(tmp_path.c_str());
+    return false;
+  }
+
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    ROS_ERROR_STREAM("Could not rename " << tmp_path << " to " << path << ": " << std::strerror(errno));
+    ::unlink(tmp_path.c_str());
+    return false;
+  }
+
+  // The rename is durable only after the directory has been flushed. Until then a power loss may
+  // bring back the previous snapshot, while the caller may already have dropped the log that covers it
+  const size_t separator = path.find_last_of('/');
+  const std::string directory = separator == std::string::npos ? "." : separator == 0 ? "/" : path.substr(0, separator);
+  int directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (directory_fd < 0)
+  {
+    ROS_ERROR_STREAM("Could not open " << directory << " for flushing: " << std::strerror(errno));
+    return false;
+  }
+  if (::fsync(directory_fd) != 0)
+  {
+    ROS_ERROR_STREAM("Could not flush " << directory << ": " << std::strerror(errno));
+    ::close(directory_fd);
+    return false;
+  }
+  ::close(directory_fd);
+  return true;
+}
+
+bool EmrSnapshot::read(const std::string& path, Items& items, uint64_t& wal_sequence)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  void* mapped = ::mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+  {
+    ROS_ERROR_STREAM("Could not memory-map " << path << ": " << std::strerror(errno));
+    return false;
+  }
+
+  bool success = decode(static_cast<const uint8_t*>(mapped), file_stat.st_size, items, wal_sequence);
+  ::munmap(mapped, file_stat.st_size);
+  return success;
+}
+
+} // temoto_context_manager namespace
@@ -0,0 +1,237 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "temoto_context_manager/emr_watch_manager.h"
+#include "temoto_core/common/tools.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace temoto_context_manager
+{
+
+EmrWatchManager::EmrWatchManager(const ros::NodeHandle& nh
+                                , std::shared_ptr<EnvModelInterface> emr_interface
+                                , const ros::WallDuration& subscribe_timeout)
+: nh_(nh)
+, emr_interface_(emr_interface)
+, subscribe_timeout_(subscribe_timeout)
+, next_watch_id_(1)
+, watch_count_(0)
+, running_(true)
+{
+  publish_thread_ = std::thread(&EmrWatchManager::publishLoop, this);
+}
+
+EmrWatchManager::~EmrWatchManager()
+{
+  running_ = false;
+  publish_cv_.notify_all();
+  if (publish_thread_.joinable())
+  {
+    publish_thread_.join();
+  }
+}
+
+uint32_t EmrWatchManager::addWatch(const WatchEmr::Request& filter, std::string& topic)
+{
+  std::lock_guard<std::mutex> lock(watches_mutex_);
+  const uint32_t watch_id = next_watch_id_++;
+
+  Watch& watch = watches_[watch_id];
+  watch.name = temoto_core::common::toSnakeCase(filter.name);
+  watch.subtree_root = temoto_core::common::toSnakeCase(filter.subtree_root);
+  watch.type = filter.type;
+  watch.min_period = ros::WallDuration(filter.max_rate > 0 ? 1.0 / filter.max_rate : 0.0);
+  watch.publisher = nh_.advertise<EmrEvents>("emr_watch/" + std::to_string(watch_id), 100);
+  watch.had_subscribers = false;
+  watch.created = ros::WallTime::now();
+  topic = watch.publisher.getTopic();
+
+  watch_count_ = watches_.size();
+  return watch_id;
+}
+
+bool EmrWatchManager::removeWatch(uint32_t watch_id)
+{
+  std::lock_guard<std::mutex> lock(watches_mutex_);
+  bool removed = watches_.erase(watch_id) != 0;
+  watch_count_ = watches_.size();
+  return removed;
+}
+
+void EmrWatchManager::onChange(uint8_t action, const emr::Item& item)
+{
+  if (watch_count_ == 0)
+  {
+    return;
+  }
+
+  const std::string name = temoto_core::common::toSnakeCase(item.getName());
+  const std::string& type = item.getPayload()->getType();
+  std::vector<std::string> ancestors;
+  for (std::shared_ptr<emr::Item> parent = item.getParent().lock(); parent; parent = parent->getParent().lock())
+  {
+    ancestors.push_back(temoto_core::common::toSnakeCase(parent->getName()));
+  }
+
+  bool notify = false;
+  {
+    std::lock_guard<std::mutex> lock(watches_mutex_);
+    for (auto& watch_entry : watches_)
+    {
+      Watch& watch = watch_entry.second;
+      if ((!watch.name.empty() && watch.name != name) ||
+          (!watch.type.empty() && watch.type != type))
+      {
+        continue;
+      }
+      if (!watch.subtree_root.empty() && watch.subtree_root != name &&
+          std::find(ancestors.begin(), ancestors.end(), watch.subtree_root) == ancestors.end())
+      {
+        continue;
+      }
+
+      // Coalesce with the event that is already pending, an addition stays an addition until removed
+      auto pending_it = watch.pending.find(name);
+      if (pending_it == watch.pending.end())
+      {
+        watch.pending.emplace(name, action);
+      }
+      else if (!(pending_it->second == EmrEvent::ADDED && action == EmrEvent::UPDATED))
+      {
+        pending_it->second = action;
+      }
+      notify = true;
+    }
+  }
+
+  if (notify)
+  {
+    publish_cv_.notify_one();
+  }
+}
+
+void EmrWatchManager::publishLoop()
+{
+  struct Batch
+  {
+    ros::Publisher publisher;
+    EmrEvents events;
+  };
+
+  while (running_)
+  {
+    std::vector<Batch> batches;
+    {
+      std::unique_lock<std::mutex> lock(watches_mutex_);
+
+      // Sleep until a watch with pending events is due, but wake up periodically to drop the
+      // watches whose clients have gone away or never showed up
+      const ros::WallTime now = ros::WallTime::now();
+      ros::WallDuration wait_time(1.0);
+      for (auto watch_it = watches_.begin(); watch_it != watches_.end();)
+      {
+        Watch& watch = watch_it->second;
+        if (watch.publisher.getNumSubscribers() > 0)
+        {
+          watch.had_subscribers = true;
+        }
+        else if (watch.had_subscribers)
+        {
+          ROS_DEBUG_STREAM("Dropping EMR watch " << watch_it->first << ", its subscribers have left");
+          watch_it = watches_.erase(watch_it);
+          continue;
+        }
+        else if (now - watch.created > subscribe_timeout_)
+        {
+          ROS_DEBUG_STREAM("Dropping EMR watch " << watch_it->first << ", nobody subscribed to it");
+          watch_it = watches_.erase(watch_it);
+          continue;
+        }
+
+        if (!watch.pending.empty())
+        {
+          const ros::WallTime due = watch.last_publish + watch.min_period;
+          if (due <= now)
+          {
+            Batch batch;
+            batch.publisher = watch.publisher;
+            batch.events.watch_id = watch_it->first;
+            for (const auto& pending : watch.pending)
+            {
+              EmrEvent event;
+              event.action = pending.second;
+              event.name = pending.first;
+              batch.events.events.push_back(event);
+            }
+            batches.push_back(batch);
+            watch.pending.clear();
+            watch.last_publish = now;
+          }
+          else
+          {
+            wait_time = std::min(wait_time, due - now);
+          }
+        }
+        ++watch_it;
+      }
+      watch_count_ = watches_.size();
+
+      if (batches.empty())
+      {
+        publish_cv_.wait_for(lock, std::chrono::nanoseconds(wait_time.toNSec()));
+        continue;
+      }
+    }
+
+    // Read the current state of the items without holding the watches, since the EMR calls
+    // onChange() while it is locked
+    for (auto& batch : batches)
+    {
+      std::vector<std::string> names;
+      std::vector<size_t> event_indices;
+      for (size_t i = 0; i < batch.events.events.size(); i++)
+      {
+        if (batch.events.events[i].action != EmrEvent::REMOVED)
+        {
+          names.push_back(batch.events.events[i].name);
+          event_indices.push_back(i);
+        }
+      }
+
+      std::vector<bool> found;
+      std::vector<ItemContainer> items = emr_interface_->getItems(names, found);
+      for (size_t i = 0; i < names.size(); i++)
+      {
+        EmrEvent& event = batch.events.events[event_indices[i]];
+        if (found[i])
+        {
+          event.item = items[i];
+        }
+        else
+        {
+          // The item was removed after the event was recorded
+          event.action = EmrEvent::REMOVED;
+        }
+      }
+      batch.publisher.publish(batch.events);
+    }
+  }
+}
+
+} // temoto_context_manager namespace
@@ -0,0 +1,497 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "temoto_context_manager/emr_write_ahead_log.h"
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace temoto_context_manager
+{
+
+/// Size of the fixed record header: payload size, checksum, sequence number and operation
+const size_t WAL_RECORD_HEADER_SIZE = 4 + 4 + 8 + 1;
+
+/// Records larger than this are considered to be corrupted
+const uint32_t WAL_MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+const std::string WAL_SEGMENT_EXTENSION = ".wal";
+
+uint32_t walCrc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+  static const std::array<uint32_t, 256> table = []
+  {
+    std::array<uint32_t, 256> t;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++)
+      {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++)
+  {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void walAppendField(std::vector<uint8_t>& payload, const void* data, uint32_t size)
+{
+  const uint8_t* size_bytes = reinterpret_cast<const uint8_t*>(&size);
+  payload.insert(payload.end(), size_bytes, size_bytes + sizeof(size));
+  payload.insert(payload.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+}
+
+bool walReadField(const std::vector<uint8_t>& payload, size_t& offset, const uint8_t*& data, uint32_t& size)
+{
+  if (offset + sizeof(size) > payload.size())
+  {
+    return false;
+  }
+  std::memcpy(&size, payload.data() + offset, sizeof(size));
+  offset += sizeof(size);
+  if (offset + size > payload.size())
+  {
+    return false;
+  }
+  data = payload.data() + offset;
+  offset += size;
+  return true;
+}
+
+bool walReadString(const std::vector<uint8_t>& payload, size_t& offset, std::string& out)
+{
+  const uint8_t* data;
+  uint32_t size;
+  if (!walReadField(payload, offset, data, size))
+  {
+    return false;
+  }
+  out.assign(reinterpret_cast<const char*>(data), size);
+  return true;
+}
+
+bool walReadBytes(const std::vector<uint8_t>& payload, size_t& offset, std::vector<uint8_t>& out)
+{
+  const uint8_t* data;
+  uint32_t size;
+  if (!walReadField(payload, offset, data, size))
+  {
+    return false;
+  }
+  out.assign(data, data + size);
+  return true;
+}
+
+bool walReadFully(int fd, uint8_t* buffer, size_t size)
+{
+  size_t total = 0;
+  while (total < size)
+  {
+    ssize_t ret = ::read(fd, buffer + total, size - total);
+    if (ret < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (ret <= 0)
+    {
+      return false;
+    }
+    total += ret;
+  }
+  return true;
+}
+
+EmrWriteAheadLog::EmrWriteAheadLog(const std::string& directory, size_t segment_size, double sync_period)
+: directory_(directory)
+, segment_size_(segment_size)
+, sync_period_(sync_period)
+, active_fd_(-1)
+, active_size_(0)
+, last_sequence_(0)
+, dirty_(false)
+, running_(false)
+{
+  if (::mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST)
+  {
+    ROS_ERROR_STREAM("Could not create the EMR write-ahead log directory " << directory_
+      << ": " << std::strerror(errno));
+  }
+}
+
+EmrWriteAheadLog::~EmrWriteAheadLog()
+{
+  {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    running_ = false;
+  }
+  sync_cv_.notify_all();
+  if (sync_thread_.joinable())
+  {
+    sync_thread_.join();
+  }
+
+  for (int fd : retired_fds_)
+  {
+    ::fdatasync(fd);
+    ::close(fd);
+  }
+  if (active_fd_ >= 0)
+  {
+    ::fdatasync(active_fd_);
+    ::close(active_fd_);
+  }
+}
+
+std::vector<EmrWriteAheadLog::Segment> EmrWriteAheadLog::listSegments() const
+{
+  std::vector<Segment> segments;
+  DIR* dir = ::opendir(directory_.c_str());
+  if (dir == nullptr)
+  {
+    return segments;
+  }
+
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    std::string file_name = entry->d_name;
+    if (file_name.size() <= WAL_SEGMENT_EXTENSION.size() ||
+        file_name.compare(file_name.size() - WAL_SEGMENT_EXTENSION.size(), WAL_SEGMENT_EXTENSION.size(), WAL_SEGMENT_EXTENSION) != 0)
+    {
+      continue;
+    }
+    char* end = nullptr;
+    uint64_t first_sequence = std::strtoull(file_name.c_str(), &end, 10);
+    if (end != file_name.c_str() + file_name.size() - WAL_SEGMENT_EXTENSION.size())
+    {
+      continue;
+    }
+    segments.push_back(Segment{first_sequence, directory_ + "/" + file_name});
+  }
+  ::closedir(dir);
+
+  std::sort(segments.begin(), segments.end(), [](const Segment& lhs, const Segment& rhs)
+  {
+    return lhs.first_sequence < rhs.first_sequence;
+  });
+  return segments;
+}
+
+size_t EmrWriteAheadLog::replay(uint64_t after_sequence, const std::function<void(const Record&)>& callback)
+{
+  std::lock_guard<std::mutex> lock(log_mutex_);
+  last_sequence_ = after_sequence;
+  size_t replayed = 0;
+
+  std::vector<Segment> segments = listSegments();
+  std::vector<uint8_t> header(WAL_RECORD_HEADER_SIZE);
+  std::vector<uint8_t> payload;
+  Record record;
+
+  for (size_t i = 0; i < segments.size(); i++)
+  {
+    int fd = ::open(segments[i].path.c_str(), O_RDWR);
+    if (fd < 0)
+    {
+      ROS_ERROR_STREAM("Could not open " << segments[i].path << ": " << std::strerror(errno));
+      continue;
+    }
+
+    off_t valid_size = 0;
+    bool corrupted = false;
+    while (true)
+    {
+      if (!walReadFully(fd, header.data(), header.size()))
+      {
+        // Either the end of the segment or a torn header
+        corrupted = ::lseek(fd, 0, SEEK_CUR) != valid_size;
+        break;
+      }
+
+      uint32_t payload_size;
+      uint32_t checksum;
+      std::memcpy(&payload_size, header.data(), 4);
+      std::memcpy(&checksum, header.data() + 4, 4);
+      std::memcpy(&record.sequence, header.data() + 8, 8);
+      record.operation = static_cast<Operation>(header[16]);
+
+      if (payload_size > WAL_MAX_PAYLOAD_SIZE)
+      {
+        corrupted = true;
+        break;
+      }
+      payload.resize(payload_size);
+      if (!walReadFully(fd, payload.data(), payload_size))
+      {
+        corrupted = true;
+        break;
+      }
+
+      uint32_t crc = walCrc32(0, header.data() + 8, WAL_RECORD_HEADER_SIZE - 8);
+      crc = walCrc32(crc, payload.data(), payload.size());
+      if (crc != checksum)
+      {
+        corrupted = true;
+        break;
+      }
+
+      size_t offset = 0;
+      bool parsed = false;
+      if (record.operation == Operation::UPDATE_ITEM)
+      {
+        parsed = walReadString(payload, offset, record.item.type) &&
+                 walReadString(payload, offset, record.item.maintainer) &&
+                 walReadBytes(payload, offset, record.item.serialized_container);
+      }
+      else if (record.operation == Operation::UPDATE_POSE)
+      {
+        parsed = walReadString(payload, offset, record.name) &&
+                 walReadBytes(payload, offset, record.serialized_pose);
+      }
+      else if (record.operation == Operation::REMOVE_ITEM)
+      {
+        parsed = walReadString(payload, offset, record.name);
+      }
+      if (!parsed)
+      {
+        corrupted = true;
+        break;
+      }
+
+      valid_size = ::lseek(fd, 0, SEEK_CUR);
+      last_sequence_ = std::max(last_sequence_, record.sequence);
+      if (record.sequence > after_sequence)
+      {
+        callback(record);
+        replayed++;
+      }
+    }
+
+    if (corrupted)
+    {
+      /*
+       * Everything after the first damaged record is discarded, including the later segments,
+       * so that the log always describes a consistent prefix of the modifications
+       */
+      ROS_WARN_STREAM("The EMR write-ahead log is damaged at " << segments[i].path << ":"
+        << valid_size << ", discarding the rest of the log");
+      if (::ftruncate(fd, valid_size) != 0)
+      {
+        ROS_ERROR_STREAM("Could not truncate " << segments[i].path << ": " << std::strerror(errno));
+      }
+      ::close(fd);
+      for (size_t j = i + 1; j < segments.size(); j++)
+      {
+        ::unlink(segments[j].path.c_str());
+      }
+      break;
+    }
+    ::close(fd);
+  }
+  return replayed;
+}
+
+bool EmrWriteAheadLog::openSegment(uint64_t first_sequence)
+{
+  char file_name[32];
+  std::snprintf(file_name, sizeof(file_name), "%020" PRIu64, first_sequence);
+  std::string path = directory_ + "/" + file_name + WAL_SEGMENT_EXTENSION;
+
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd < 0)
+  {
+    ROS_ERROR_STREAM("Could not create the EMR write-ahead log segment " << path << ": " << std::strerror(errno));
+    return false;
+  }
+
+  // Make sure the new segment survives a crash
+  int dir_fd = ::open(directory_.c_str(), O_RDONLY);
+  if (dir_fd >= 0)
+  {
+    ::fsync(dir_fd);
+    ::close(dir_fd);
+  }
+
+  if (active_fd_ >= 0)
+  {
+    retired_fds_.push_back(active_fd_);
+  }
+  active_fd_ = fd;
+  active_size_ = 0;
+  return true;
+}
+
+bool EmrWriteAheadLog::start()
+{
+  std::lock_guard<std::mutex> lock(log_mutex_);
+  if (!openSegment(last_sequence_ + 1))
+  {
+    return false;
+  }
+  running_ = true;
+  sync_thread_ = std::thread(&EmrWriteAheadLog::syncLoop, this);
+  return true;
+}
+
+void EmrWriteAheadLog::writeRecord(Operation operation, const std::vector<uint8_t>& payload)
+{
+  std::lock_guard<std::mutex> lock(log_mutex_);
+  if (active_fd_ < 0)
+  {
+    return;
+  }
+
+  std::vector<uint8_t> record(WAL_RECORD_HEADER_SIZE + payload.size());
+  uint64_t sequence = last_sequence_ + 1;
+  uint32_t payload_size = payload.size();
+  std::memcpy(record.data(), &payload_size, 4);
+  std::memcpy(record.data() + 8, &sequence, 8);
+  record[16] = static_cast<uint8_t>(operation);
+  std::copy(payload.begin(), payload.end(), record.begin() + WAL_RECORD_HEADER_SIZE);
+  uint32_t checksum = walCrc32(0, record.data() + 8, record.size() - 8);
+  std::memcpy(record.data() + 4, &checksum, 4);
+
+  // Start a new segment once the active one is full
+  if (active_size_ != 0 && active_size_ + record.size() > segment_size_)
+  {
+    if (!openSegment(sequence))
+    {
+      return;
+    }
+  }
+
+  size_t written = 0;
+  while (written < record.size())
+  {
+    ssize_t ret = ::write(active_fd_, record.data() + written, record.size() - written);
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      ROS_ERROR_STREAM("Could not append to the EMR write-ahead log: " << std::strerror(errno));
+      return;
+    }
+    written += ret;
+  }
+
+  last_sequence_ = sequence;
+  active_size_ += record.size();
+  dirty_ = true;
+}
+
+void EmrWriteAheadLog::appendItemUpdate(const ItemContainer& item)
+{
+  std::vector<uint8_t> payload;
+  payload.reserve(12 + item.type.size() + item.maintainer.size() + item.serialized_container.size());
+  walAppendField(payload, item.type.data(), item.type.size());
+  walAppendField(payload, item.maintainer.data(), item.maintainer.size());
+  walAppendField(payload, item.serialized_container.data(), item.serialized_container.size());
+  writeRecord(Operation::UPDATE_ITEM, payload);
+}
+
+void EmrWriteAheadLog::appendPoseUpdate(const std::string& name, const std::vector<uint8_t>& serialized_pose)
+{
+  std::vector<uint8_t> payload;
+  payload.reserve(8 + name.size() + serialized_pose.size());
+  walAppendField(payload, name.data(), name.size());
+  walAppendField(payload, serialized_pose.data(), serialized_pose.size());
+  writeRecord(Operation::UPDATE_POSE, payload);
+}
+
+void EmrWriteAheadLog::appendItemRemoval(const std::string& name)
+{
+  std::vector<uint8_t> payload;
+  walAppendField(payload, name.data(), name.size());
+  writeRecord(Operation::REMOVE_ITEM, payload);
+}
+
+uint64_t EmrWriteAheadLog::getLastSequence() const
+{
+  std::lock_guard<std::mutex> lock(log_mutex_);
+  return last_sequence_;
+}
+
+void EmrWriteAheadLog::compact(uint64_t snapshot_sequence)
+{
+  std::lock_guard<std::mutex> lock(log_mutex_);
+
+  // Close the active segment if the snapshot covers all of it, so that it can be removed as well
+  if (active_fd_ >= 0 && active_size_ != 0 && last_sequence_ <= snapshot_sequence)
+  {
+    openSegment(last_sequence_ + 1);
+  }
+
+  // A segment is covered by the snapshot if the segment following it starts after the snapshot
+  std::vector<Segment> segments = listSegments();
+  for (size_t i = 0; i + 1 < segments.size(); i++)
+  {
+    if (segments[i + 1].first_sequence - 1 <= snapshot_sequence)
+    {
+      ::unlink(segments[i].path.c_str());
+    }
+  }
+}
+
+void EmrWriteAheadLog::syncLoop()
+{
+  std::unique_lock<std::mutex> lock(log_mutex_);
+  while (running_)
+  {
+    sync_cv_.wait_for(lock, std::chrono::duration<double>(sync_period_), [this]{ return !running_; });
+
+    std::vector<int> retired_fds;
+    retired_fds.swap(retired_fds_);
+    int fd = active_fd_;
+    bool dirty = dirty_;
+    dirty_ = false;
+    lock.unlock();
+
+    // The descriptors are closed only by this thread, hence they stay valid without the lock
+    for (int retired_fd : retired_fds)
+    {
+      ::fdatasync(retired_fd);
+      ::close(retired_fd);
+    }
+    if (dirty && fd >= 0)
+    {
+      ::fdatasync(fd);
+    }
+
+    lock.lock();
+  }
+}
+
+} // temoto_context_manager namespace
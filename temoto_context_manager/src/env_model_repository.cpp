@@ -16,6 +16,7 @@
 
 /* Author: Meelis Pihlap */
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -27,7 +28,7 @@ namespace emr
 {
 void EnvironmentModelRepository::addItem(const std::string& name, const std::string& parent, std::shared_ptr<PayloadEntry> payload)
 {
-  std::lock_guard<std::mutex> lock(emr_mutex);
+  std::lock_guard<std::shared_timed_mutex> lock(emr_mutex);
   // Check if we need to attach to a parent
   if (parent == "")
   {
@@ -45,18 +46,34 @@ void EnvironmentModelRepository::addItem(const std::string& name, const std::str
 
 void EnvironmentModelRepository::updateItem(const std::string& name, std::shared_ptr<PayloadEntry> plptr)
 {
-  std::lock_guard<std::mutex> lock(emr_mutex);
+  std::lock_guard<std::shared_timed_mutex> lock(emr_mutex);
   items[name]->setPayload(plptr);
 }
 
+void EnvironmentModelRepository::removeItem(const std::string name)
+{
+  std::lock_guard<std::shared_timed_mutex> lock(emr_mutex);
+  const auto item_it = items.find(name);
+  if (item_it == items.end())
+  {
+    return;
+  }
+  // Otherwise the parent would keep the removed item alive as a part of the tree
+  if (std::shared_ptr<Item> parent = item_it->second->getParent().lock())
+  {
+    parent->removeChild(item_it->second);
+  }
+  items.erase(item_it);
+}
+
 bool EnvironmentModelRepository::hasItem(const std::string& name)
 {
-  std::lock_guard<std::mutex> lock(emr_mutex);
+  std::shared_lock<std::shared_timed_mutex> lock(emr_mutex);
   return items.count(name);
 }
 std::vector<std::shared_ptr<Item>> EnvironmentModelRepository::getRootItems() const
 {
-  std::lock_guard<std::mutex> lock(emr_mutex);
+  std::shared_lock<std::shared_timed_mutex> lock(emr_mutex);
   std::vector<std::shared_ptr<Item>> root_items;
   for (auto const& pair : items)
   {
@@ -77,6 +94,15 @@ void Item::addChild(std::shared_ptr<Item> child)
   children_.push_back(child);
   child->setParent(shared_from_this());
 }
+/**
+ * @brief Remove child item
+ * 
+ * @param child - pointer to the item to be removed
+ */
+void Item::removeChild(const std::shared_ptr<Item>& child)
+{
+  children_.erase(std::remove(children_.begin(), children_.end(), child), children_.end());
+}
 /**
  * @brief Set parent of item
  * 
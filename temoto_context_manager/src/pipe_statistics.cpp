@@ -0,0 +1,143 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#include "temoto_context_manager/pipe_statistics.h"
+#include <ros/ros.h>
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace temoto_context_manager
+{
+
+PipeStatistics::PipeStatistics(double smoothing)
+: smoothing_(std::min(std::max(smoothing, 0.0), 1.0))
+{}
+
+void PipeStatistics::record(const std::string& pipe_name, bool success, double latency)
+{
+  Entry& entry = entries_[pipe_name];
+  if (entry.attempts == 0)
+  {
+    // The first attempt replaces the optimistic defaults
+    entry.success_rate = success ? 1.0 : 0.0;
+    entry.latency = latency;
+  }
+  else
+  {
+    entry.success_rate += smoothing_ * ((success ? 1.0 : 0.0) - entry.success_rate);
+    entry.latency += smoothing_ * (latency - entry.latency);
+  }
+  entry.attempts++;
+}
+
+PipeStatistics::Entry PipeStatistics::get(const std::string& pipe_name) const
+{
+  auto entry_it = entries_.find(pipe_name);
+  return entry_it == entries_.end() ? Entry() : entry_it->second;
+}
+
+double PipeStatistics::getExpectedCost(const std::string& pipe_name) const
+{
+  const Entry entry = get(pipe_name);
+  if (entry.attempts == 0)
+  {
+    return 0.0;
+  }
+
+  // A pipe that keeps failing is still retried once in a while after the others
+  return entry.latency / std::max(entry.success_rate, 0.01);
+}
+
+std::vector<size_t> PipeStatistics::rank(const std::vector<std::string>& pipe_names) const
+{
+  std::vector<double> costs;
+  std::vector<size_t> order;
+  for (size_t i = 0; i < pipe_names.size(); i++)
+  {
+    costs.push_back(getExpectedCost(pipe_names[i]));
+    order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(), [&costs](size_t lhs, size_t rhs)
+  {
+    return costs[lhs] < costs[rhs];
+  });
+  return order;
+}
+
+bool PipeStatistics::load(const std::string& path)
+{
+  try
+  {
+    YAML::Node statistics = YAML::LoadFile(path);
+    for (YAML::const_iterator it = statistics.begin(); it != statistics.end(); ++it)
+    {
+      Entry entry;
+      entry.success_rate = it->second["success_rate"].as<double>();
+      entry.latency = it->second["latency"].as<double>();
+      entry.attempts = it->second["attempts"].as<unsigned int>();
+      entries_[it->first.as<std::string>()] = entry;
+    }
+  }
+  catch (const YAML::Exception& e)
+  {
+    ROS_DEBUG_STREAM("Could not read the pipe statistics from " << path << ": " << e.what());
+    return false;
+  }
+  return true;
+}
+
+bool PipeStatistics::save(const std::string& path) const
+{
+  YAML::Emitter out;
+  out << YAML::BeginMap;
+  for (const auto& entry : entries_)
+  {
+    out << YAML::Key << entry.first << YAML::Value << YAML::BeginMap
+        << YAML::Key << "success_rate" << YAML::Value << entry.second.success_rate
+        << YAML::Key << "latency" << YAML::Value << entry.second.latency
+        << YAML::Key << "attempts" << YAML::Value << entry.second.attempts
+        << YAML::EndMap;
+  }
+  out << YAML::EndMap;
+
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    file << out.c_str() << std::endl;
+    if (!file)
+    {
+      ROS_ERROR_STREAM("Could not write the pipe statistics to " << tmp_path);
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    ROS_ERROR_STREAM("Could not rename " << tmp_path << " to " << path << ": " << std::strerror(errno));
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+} // temoto_context_manager namespace
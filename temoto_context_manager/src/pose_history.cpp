@@ -0,0 +1,131 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "temoto_context_manager/pose_history.h"
+
+namespace temoto_context_manager
+{
+
+PoseHistory::PoseHistory(size_t capacity, const ros::Duration& horizon)
+: samples_(capacity > 0 ? capacity : 1)
+, capacity_(samples_.size())
+, horizon_(horizon)
+, head_(0)
+, size_(0)
+{}
+
+void PoseHistory::add(const geometry_msgs::PoseStamped& pose)
+{
+  Sample sample;
+  sample.stamp = pose.header.stamp;
+  sample.position = tf::Vector3(pose.pose.position.x, pose.pose.position.y, pose.pose.position.z);
+  sample.orientation = tf::Quaternion(pose.pose.orientation.x,
+                                      pose.pose.orientation.y,
+                                      pose.pose.orientation.z,
+                                      pose.pose.orientation.w);
+  if (sample.orientation.length2() == 0)
+  {
+    sample.orientation = tf::Quaternion::getIdentity();
+  }
+  // Poses in different frames can not be interpolated, start over when the parent changes
+  if (pose.header.frame_id != frame_id_)
+  {
+    frame_id_ = pose.header.frame_id;
+    head_ = 0;
+    size_ = 0;
+  }
+
+  if (size_ > 0)
+  {
+    const Sample& newest = at(size_ - 1);
+    if (sample.stamp < newest.stamp)
+    {
+      return;
+    }
+    if (sample.stamp == newest.stamp)
+    {
+      samples_[(head_ + capacity_ - 1) % capacity_] = sample;
+      return;
+    }
+  }
+
+  samples_[head_] = sample;
+  head_ = (head_ + 1) % capacity_;
+  if (size_ < capacity_)
+  {
+    size_++;
+  }
+}
+
+bool PoseHistory::getPoseAt(const ros::Time& stamp, geometry_msgs::PoseStamped& pose) const
+{
+  if (size_ == 0)
+  {
+    return false;
+  }
+
+  const Sample& newest = at(size_ - 1);
+  const ros::Time oldest_usable = newest.stamp.toSec() > horizon_.toSec() ? newest.stamp - horizon_ : ros::Time();
+  if (stamp < at(0).stamp || stamp < oldest_usable)
+  {
+    return false;
+  }
+
+  tf::Vector3 position;
+  tf::Quaternion orientation;
+  if (stamp >= newest.stamp)
+  {
+    position = newest.position;
+    orientation = newest.orientation;
+  }
+  else
+  {
+    // Binary search for the first sample that is newer than the requested time
+    size_t low = 0;
+    size_t high = size_ - 1;
+    while (low < high)
+    {
+      const size_t middle = (low + high) / 2;
+      if (at(middle).stamp <= stamp)
+      {
+        low = middle + 1;
+      }
+      else
+      {
+        high = middle;
+      }
+    }
+
+    const Sample& before = at(low - 1);
+    const Sample& after = at(low);
+    const double ratio = (stamp - before.stamp).toSec() / (after.stamp - before.stamp).toSec();
+    position = before.position.lerp(after.position, ratio);
+    orientation = before.orientation.slerp(after.orientation, ratio);
+  }
+
+  pose.header.stamp = stamp;
+  pose.header.frame_id = frame_id_;
+  pose.pose.position.x = position.x();
+  pose.pose.position.y = position.y();
+  pose.pose.position.z = position.z();
+  pose.pose.orientation.x = orientation.x();
+  pose.pose.orientation.y = orientation.y();
+  pose.pose.orientation.z = orientation.z();
+  pose.pose.orientation.w = orientation.w();
+  return true;
+}
+
+} // temoto_context_manager namespace
@@ -0,0 +1,310 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "temoto_context_manager/spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace emr
+{
+
+namespace
+{
+
+double squaredDistance(const SpatialIndex::Position& a, const SpatialIndex::Position& b)
+{
+  const double dx = a.x - b.x;
+  const double dy = a.y - b.y;
+  const double dz = a.z - b.z;
+  return dx * dx + dy * dy + dz * dz;
+}
+
+bool compareDistance(const SpatialIndex::Match& a, const SpatialIndex::Match& b)
+{
+  return a.distance < b.distance;
+}
+
+const double MAX_CELL_COORDINATE = 1e15;
+
+} // anonymous namespace
+
+SpatialIndex::SpatialIndex(double cell_size)
+: cell_size_(cell_size > 0.0 ? cell_size : 1.0)
+{}
+
+SpatialIndex::CellKey SpatialIndex::getCellKey(const Position& position) const
+{
+  // Clamp, so that unbounded query regions do not overflow the cell coordinates
+  auto to_cell = [this](double coordinate)
+  {
+    const double cell = std::floor(coordinate / cell_size_);
+    return int64_t(std::max(-MAX_CELL_COORDINATE, std::min(MAX_CELL_COORDINATE, cell)));
+  };
+  return CellKey{to_cell(position.x), to_cell(position.y), to_cell(position.z)};
+}
+
+void SpatialIndex::update(const std::string& name, const Position& position)
+{
+  const CellKey cell = getCellKey(position);
+  auto entry_it = entries_.find(name);
+  if (entry_it != entries_.end())
+  {
+    entry_it->second.position = position;
+    if (entry_it->second.cell == cell)
+    {
+      return;
+    }
+    remove(name);
+  }
+
+  entry_it = entries_.emplace(name, Entry{position, cell}).first;
+  cells_[cell].push_back(&*entry_it);
+}
+
+void SpatialIndex::remove(const std::string& name)
+{
+  auto entry_it = entries_.find(name);
+  if (entry_it == entries_.end())
+  {
+    return;
+  }
+
+  auto cell_it = cells_.find(entry_it->second.cell);
+  if (cell_it != cells_.end())
+  {
+    auto& members = cell_it->second;
+    auto member_it = std::find(members.begin(), members.end(), &*entry_it);
+    if (member_it != members.end())
+    {
+      *member_it = members.back();
+      members.pop_back();
+    }
+    if (members.empty())
+    {
+      cells_.erase(cell_it);
+    }
+  }
+  entries_.erase(entry_it);
+}
+
+bool SpatialIndex::getPosition(const std::string& name, Position& position) const
+{
+  const auto entry_it = entries_.find(name);
+  if (entry_it == entries_.end())
+  {
+    return false;
+  }
+  position = entry_it->second.position;
+  return true;
+}
+
+template <class Visitor>
+void SpatialIndex::visitCells(const CellKey& min_cell, const CellKey& max_cell, Visitor visitor) const
+{
+  const double cell_count = double(max_cell.x - min_cell.x + 1)
+                          * double(max_cell.y - min_cell.y + 1)
+                          * double(max_cell.z - min_cell.z + 1);
+
+  // A large region over a sparse grid is cheaper to answer by scanning the non-empty cells
+  if (cell_count > double(cells_.size()))
+  {
+    for (const auto& cell : cells_)
+    {
+      const CellKey& key = cell.first;
+      if (key.x < min_cell.x || key.x > max_cell.x ||
+          key.y < min_cell.y || key.y > max_cell.y ||
+          key.z < min_cell.z || key.z > max_cell.z)
+      {
+        continue;
+      }
+      for (EntryRef entry : cell.second)
+      {
+        visitor(entry);
+      }
+    }
+    return;
+  }
+
+  for (int64_t x = min_cell.x; x <= max_cell.x; x++)
+  {
+    for (int64_t y = min_cell.y; y <= max_cell.y; y++)
+    {
+      for (int64_t z = min_cell.z; z <= max_cell.z; z++)
+      {
+        const auto cell_it = cells_.find(CellKey{x, y, z});
+        if (cell_it == cells_.end())
+        {
+          continue;
+        }
+        for (EntryRef entry : cell_it->second)
+        {
+          visitor(entry);
+        }
+      }
+    }
+  }
+}
+
+std::vector<SpatialIndex::Match> SpatialIndex::radiusSearch(const Position& center, double radius) const
+{
+  std::vector<Match> matches;
+  if (radius < 0.0 || entries_.empty())
+  {
+    return matches;
+  }
+
+  const double squared_radius = radius * radius;
+  const CellKey min_cell = getCellKey(Position{center.x - radius, center.y - radius, center.z - radius});
+  const CellKey max_cell = getCellKey(Position{center.x + radius, center.y + radius, center.z + radius});
+  visitCells(min_cell, max_cell, [&](EntryRef entry)
+  {
+    const double squared_distance = squaredDistance(entry->second.position, center);
+    if (squared_distance <= squared_radius)
+    {
+      matches.push_back(Match{entry->first, entry->second.position, std::sqrt(squared_distance)});
+    }
+  });
+
+  std::sort(matches.begin(), matches.end(), compareDistance);
+  return matches;
+}
+
+std::vector<SpatialIndex::Match> SpatialIndex::boxSearch(const Position& min_corner, const Position& max_corner) const
+{
+  std::vector<Match> matches;
+  if (min_corner.x > max_corner.x || min_corner.y > max_corner.y || min_corner.z > max_corner.z ||
+      entries_.empty())
+  {
+    return matches;
+  }
+
+  const Position center{(min_corner.x + max_corner.x) / 2.0,
+                        (min_corner.y + max_corner.y) / 2.0,
+                        (min_corner.z + max_corner.z) / 2.0};
+  visitCells(getCellKey(min_corner), getCellKey(max_corner), [&](EntryRef entry)
+  {
+    const Position& p = entry->second.position;
+    if (p.x >= min_corner.x && p.x <= max_corner.x &&
+        p.y >= min_corner.y && p.y <= max_corner.y &&
+        p.z >= min_corner.z && p.z <= max_corner.z)
+    {
+      matches.push_back(Match{entry->first, p, std::sqrt(squaredDistance(p, center))});
+    }
+  });
+
+  std::sort(matches.begin(), matches.end(), compareDistance);
+  return matches;
+}
+
+std::vector<SpatialIndex::Match> SpatialIndex::nearestSearch(const Position& center, size_t k) const
+{
+  std::vector<Match> matches;
+  if (k == 0 || entries_.empty())
+  {
+    return matches;
+  }
+
+  // Max-heap of the k best candidates found so far, keyed by the squared distance
+  typedef std::pair<double, EntryRef> Candidate;
+  auto farther = [](const Candidate& a, const Candidate& b) {return a.first < b.first;};
+  std::priority_queue<Candidate, std::vector<Candidate>, decltype(farther)> best(farther);
+  auto consider = [&](EntryRef entry)
+  {
+    const double squared_distance = squaredDistance(entry->second.position, center);
+    if (best.size() < k)
+    {
+      best.emplace(squared_distance, entry);
+    }
+    else if (squared_distance < best.top().first)
+    {
+      best.pop();
+      best.emplace(squared_distance, entry);
+    }
+  };
+
+  /*
+   * Visit the cells in rings of growing Chebyshev distance around the center cell. Every point
+   * beyond ring r is at least r cell sizes away from the center, so the search can stop as soon
+   * as the k-th best candidate is closer than that. Once the rings would visit more cells than
+   * there are points, the remaining points are scanned directly.
+   */
+  const CellKey center_cell = getCellKey(center);
+  size_t visited = 0;
+  bool exhausted = false;
+  for (int64_t r = 0; ; r++)
+  {
+    const double ring_side = double(2 * r + 1);
+    if (ring_side * ring_side * ring_side > double(entries_.size()) + double(cells_.size()))
+    {
+      break;
+    }
+
+    for (int64_t x = center_cell.x - r; x <= center_cell.x + r; x++)
+    {
+      for (int64_t y = center_cell.y - r; y <= center_cell.y + r; y++)
+      {
+        const bool on_shell = std::abs(x - center_cell.x) == r || std::abs(y - center_cell.y) == r;
+        const int64_t z_step = on_shell ? 1 : std::max<int64_t>(2 * r, 1);
+        for (int64_t z = center_cell.z - r; z <= center_cell.z + r; z += z_step)
+        {
+          const auto cell_it = cells_.find(CellKey{x, y, z});
+          if (cell_it == cells_.end())
+          {
+            continue;
+          }
+          for (EntryRef entry : cell_it->second)
+          {
+            consider(entry);
+          }
+          visited += cell_it->second.size();
+        }
+      }
+    }
+
+    const double reach = double(r) * cell_size_;
+    if (visited == entries_.size() || (best.size() == k && best.top().first <= reach * reach))
+    {
+      exhausted = true;
+      break;
+    }
+  }
+
+  if (!exhausted)
+  {
+    while (!best.empty())
+    {
+      best.pop();
+    }
+    for (const auto& entry : entries_)
+    {
+      consider(&entry);
+    }
+  }
+
+  matches.reserve(best.size());
+  while (!best.empty())
+  {
+    const Candidate& candidate = best.top();
+    matches.push_back(Match{candidate.second->first, candidate.second->second.position, std::sqrt(candidate.first)});
+    best.pop();
+  }
+  std::reverse(matches.begin(), matches.end());
+  return matches;
+}
+
+} // namespace emr
@@ -0,0 +1,172 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "temoto_context_manager/timer_wheel.h"
+
+#include <algorithm>
+
+namespace emr
+{
+
+TimerWheel::TimerWheel()
+: current_tick_(0)
+, started_(false)
+{}
+
+void TimerWheel::schedule(const std::string& name, uint64_t deadline)
+{
+  if (!started_)
+  {
+    current_tick_ = deadline;
+    started_ = true;
+  }
+
+  auto timer_it = timers_.find(name);
+  if (timer_it == timers_.end())
+  {
+    timer_it = timers_.emplace(name, Timer{0, nullptr, Slot::iterator()}).first;
+  }
+  else
+  {
+    timer_it->second.slot->erase(timer_it->second.position);
+  }
+
+  // A deadline that is already due goes to the next tick, so it is collected by the next advance()
+  if (deadline <= current_tick_)
+  {
+    deadline = current_tick_ + 1;
+  }
+  else if (deadline - current_tick_ >= span())
+  {
+    deadline = current_tick_ + span() - 1;
+  }
+  timer_it->second.deadline = deadline;
+  place(timer_it);
+}
+
+void TimerWheel::cancel(const std::string& name)
+{
+  auto timer_it = timers_.find(name);
+  if (timer_it != timers_.end())
+  {
+    timer_it->second.slot->erase(timer_it->second.position);
+    timers_.erase(timer_it);
+  }
+}
+
+bool TimerWheel::isScheduled(const std::string& name) const
+{
+  return timers_.find(name) != timers_.end();
+}
+
+void TimerWheel::place(std::unordered_map<std::string, Timer>::iterator timer_it)
+{
+  Timer& timer = timer_it->second;
+  const uint64_t delta = timer.deadline - current_tick_;
+  unsigned int level = 0;
+  while (level + 1 < LEVELS && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1))))
+  {
+    level++;
+  }
+  Slot& slot = wheel_[level][(timer.deadline >> (SLOT_BITS * level)) & (SLOTS - 1)];
+  timer.slot = &slot;
+  timer.position = slot.insert(slot.end(), timer_it->first);
+}
+
+void TimerWheel::cascade(unsigned int level)
+{
+  Slot slot;
+  slot.swap(wheel_[level][(current_tick_ >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+  for (const std::string& name : slot)
+  {
+    place(timers_.find(name));
+  }
+}
+
+std::vector<std::string> TimerWheel::advance(uint64_t now)
+{
+  std::vector<std::string> expired;
+  if (!started_)
+  {
+    current_tick_ = now;
+    started_ = true;
+    return expired;
+  }
+  if (now <= current_tick_)
+  {
+    return expired;
+  }
+
+  // After a long jump, e.g. when the clock is reset, stepping tick by tick would be too slow
+  if (now - current_tick_ >= span())
+  {
+    for (auto& level : wheel_)
+    {
+      for (Slot& slot : level)
+      {
+        slot.clear();
+      }
+    }
+    std::vector<std::pair<uint64_t, std::string>> due;
+    for (auto timer_it = timers_.begin(); timer_it != timers_.end();)
+    {
+      if (timer_it->second.deadline <= now)
+      {
+        due.emplace_back(timer_it->second.deadline, timer_it->first);
+        timer_it = timers_.erase(timer_it);
+      }
+      else
+      {
+        ++timer_it;
+      }
+    }
+    current_tick_ = now;
+    for (auto timer_it = timers_.begin(); timer_it != timers_.end(); ++timer_it)
+    {
+      place(timer_it);
+    }
+    std::sort(due.begin(), due.end());
+    for (auto& entry : due)
+    {
+      expired.push_back(std::move(entry.second));
+    }
+    return expired;
+  }
+
+  while (current_tick_ < now)
+  {
+    current_tick_++;
+
+    // Cascade the levels whose lower levels have just wrapped around
+    for (unsigned int level = 1;
+         level < LEVELS && ((current_tick_ >> (SLOT_BITS * (level - 1))) & (SLOTS - 1)) == 0;
+         level++)
+    {
+      cascade(level);
+    }
+
+    Slot& slot = wheel_[0][current_tick_ & (SLOTS - 1)];
+    for (const std::string& name : slot)
+    {
+      timers_.erase(name);
+      expired.push_back(name);
+    }
+    slot.clear();
+  }
+  return expired;
+}
+
+} // emr namespace
@@ -0,0 +1,134 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#include "temoto_context_manager/tracked_object_demux.h"
+#include "temoto_core/common/tools.h"
+#include <tf/transform_datatypes.h>
+
+namespace temoto_context_manager
+{
+
+TrackedObjectDemux::TrackedObjectDemux(const ros::NodeHandle& nh
+                                      , std::shared_ptr<EnvModelInterface> emr_interface
+                                      , const std::string& detections_topic)
+: nh_(nh)
+, emr_interface_(emr_interface)
+, detections_topic_(detections_topic)
+{
+  detections_subscriber_ = nh_.subscribe(detections_topic_, 100, &TrackedObjectDemux::detectionCb, this);
+}
+
+void TrackedObjectDemux::addObject(const std::string& object_name, const std::string& object_topic)
+{
+  std::lock_guard<std::mutex> lock(objects_mutex_);
+  object_publishers_[temoto_core::common::toSnakeCase(object_name)] = nh_.advertise<ObjectContainer>(object_topic, 10);
+}
+
+size_t TrackedObjectDemux::removeObject(const std::string& object_name)
+{
+  std::lock_guard<std::mutex> lock(objects_mutex_);
+  object_publishers_.erase(temoto_core::common::toSnakeCase(object_name));
+  return object_publishers_.size();
+}
+
+const std::string& TrackedObjectDemux::getDetectionsTopic() const
+{
+  return detections_topic_;
+}
+
+void TrackedObjectDemux::detectionCb(const ObjectContainer::ConstPtr& detection)
+{
+  // Detectors that recognize the objects themselves name them
+  if (!detection->name.empty())
+  {
+    ros::Publisher object_publisher;
+    {
+      std::lock_guard<std::mutex> lock(objects_mutex_);
+      auto publisher_it = object_publishers_.find(temoto_core::common::toSnakeCase(detection->name));
+      if (publisher_it == object_publishers_.end())
+      {
+        return;
+      }
+      object_publisher = publisher_it->second;
+    }
+
+    // The object may have been removed from the EMR while it is tracked
+    if (!emr_interface_->hasItem(detection->name))
+    {
+      ROS_DEBUG_STREAM("Dropping the detection of " << detection->name << ", it is not in the EMR");
+      return;
+    }
+    emr_interface_->updatePose(detection->name, detection->pose);
+    object_publisher.publish(detection);
+    return;
+  }
+
+  std::vector<bool> found;
+  std::vector<TaggedObject> tagged_objects = emr_interface_->getObjectsByTagIds({detection->tag_id}, found);
+  if (!found.front())
+  {
+    return;
+  }
+  const TaggedObject& tagged_object = tagged_objects.front();
+
+  ros::Publisher object_publisher;
+  {
+    std::lock_guard<std::mutex> lock(objects_mutex_);
+    auto publisher_it = object_publishers_.find(temoto_core::common::toSnakeCase(tagged_object.name));
+    if (publisher_it == object_publishers_.end())
+    {
+      return;
+    }
+    object_publisher = publisher_it->second;
+  }
+
+  /*
+   * The object is offset from its tag by obj_relative_pose. If the offset is unspecified, then the
+   * object is assumed to be where the tag is
+   */
+  tf::Transform tag_transform;
+  tf::poseMsgToTF(detection->pose.pose, tag_transform);
+  const geometry_msgs::Quaternion& relative_orientation = tagged_object.obj_relative_pose.orientation;
+  if (relative_orientation.x != 0 || relative_orientation.y != 0 ||
+      relative_orientation.z != 0 || relative_orientation.w != 0)
+  {
+    tf::Transform relative_transform;
+    tf::poseMsgToTF(tagged_object.obj_relative_pose, relative_transform);
+    tag_transform *= relative_transform;
+  }
+
+  geometry_msgs::PoseStamped object_pose;
+  object_pose.header = detection->pose.header;
+  tf::poseTFToMsg(tag_transform, object_pose.pose);
+
+  if (!emr_interface_->hasItem(tagged_object.name))
+  {
+    ROS_DEBUG_STREAM("Dropping the detection of " << tagged_object.name << ", it is not in the EMR");
+    return;
+  }
+  emr_interface_->updatePose(tagged_object.name, object_pose);
+
+  ObjectContainer object;
+  object.name = tagged_object.name;
+  object.detection_methods = {ObjectContainer::ARTAG};
+  object.tag_id = detection->tag_id;
+  object.obj_relative_pose = tagged_object.obj_relative_pose;
+  object.pose = object_pose;
+  object_publisher.publish(object);
+}
+
+} // temoto_context_manager namespace